@@ -0,0 +1,102 @@
+#ifndef BLOCK_ENTITIES_H
+#define BLOCK_ENTITIES_H
+
+#include <iostream>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include "World.h"
+#include "Mirror.h"
+
+struct Block_mirror{
+    unsigned int texture_ID; // Texture of the mirror (see Mirror::destroy), 0 while its chunk is unloaded
+    glm::ivec3 normal; // Face of the block the mirror is attached to, to create the mirror again when the chunk is loaded back
+};
+
+struct Block_entity{ // Data of a block beyond its block ID, which only a few blocks have
+    int x, y, z; // Coordinates of the block
+    std::vector<Block_mirror> mirrors; // Mirrors attached to the block
+};
+
+class Block_entities{ // Sparse table of the block entities keyed by World::block_key, so that chunks only store block IDs and blocks without entity cost nothing
+public:
+    Block_entity* find(int x, int y, int z){ // nullptr if block (x,y,z) has no entity
+        auto it = entities.find(World::block_key(x, y, z));
+        return it == entities.end() ? nullptr : &it->second;
+    }
+
+    Block_entity& get(int x, int y, int z){ // Entity of block (x,y,z), created empty if needed
+        auto inserted = entities.try_emplace(World::block_key(x, y, z));
+        if (inserted.second){
+            inserted.first->second.x = x;
+            inserted.first->second.y = y;
+            inserted.first->second.z = z;
+            entities_per_chunk[chunk_key_of_block(x, y, z)]++;
+        }
+        return inserted.first->second;
+    }
+
+    void destroy(int x, int y, int z){ // Destroys the entity of block (x,y,z) and what is attached to it, if any. Constant time per attached mirror
+        auto it = entities.find(World::block_key(x, y, z));
+        if (it == entities.end()) return;
+        destroy_entity(it->second);
+        entities.erase(it);
+        auto count = entities_per_chunk.find(chunk_key_of_block(x, y, z));
+        if (--count->second == 0) entities_per_chunk.erase(count);
+    }
+
+    void unload_chunk(int chunk_x, int chunk_y, int chunk_z){ // Destroys the mirrors of the entities of a chunk and sets the entities aside until load_chunk. Only looks at the entities if the chunk has some
+        int64_t key = World::chunk_key(chunk_x, chunk_y, chunk_z);
+        auto count = entities_per_chunk.find(key);
+        if (count == entities_per_chunk.end()) return;
+        entities_per_chunk.erase(count);
+        std::vector<Block_entity> &unloaded = unloaded_entities[key];
+        for (auto it = entities.begin(); it != entities.end();){
+            Block_entity &entity = it->second;
+            if (World::chunk_coord(entity.x) != chunk_x || World::chunk_coord(entity.y) != chunk_y || World::chunk_coord(entity.z) != chunk_z){
+                it++;
+                continue;
+            }
+            destroy_entity(entity);
+            for (Block_mirror &mirror: entity.mirrors) mirror.texture_ID = 0;
+            unloaded.push_back(entity);
+            it = entities.erase(it);
+        }
+    }
+
+    template <typename Create_mirror> void load_chunk(int chunk_x, int chunk_y, int chunk_z, Create_mirror create_mirror){ // Gives back the entities set aside by unload_chunk, create_mirror(entity, normal) creating each of their mirrors
+        // and returning its texture ID. Blocks can't be edited while their chunk is unloaded, so the entities still match their blocks
+        auto it = unloaded_entities.find(World::chunk_key(chunk_x, chunk_y, chunk_z));
+        if (it == unloaded_entities.end()) return;
+        for (Block_entity &unloaded: it->second){
+            Block_entity &entity = get(unloaded.x, unloaded.y, unloaded.z);
+            for (Block_mirror mirror: unloaded.mirrors){
+                mirror.texture_ID = create_mirror(entity, mirror.normal);
+                entity.mirrors.push_back(mirror);
+            }
+        }
+        unloaded_entities.erase(it);
+    }
+
+    bool empty() const {
+        return entities.empty();
+    }
+
+    size_t size() const {
+        return entities.size();
+    }
+
+private:
+    std::unordered_map<int64_t, Block_entity> entities;
+    std::unordered_map<int64_t, int> entities_per_chunk; // Number of entities in each chunk, keyed by World::chunk_key
+    std::unordered_map<int64_t, std::vector<Block_entity>> unloaded_entities; // Entities of the unloaded chunks, keyed by World::chunk_key
+
+    static int64_t chunk_key_of_block(int x, int y, int z){
+        return World::chunk_key(World::chunk_coord(x), World::chunk_coord(y), World::chunk_coord(z));
+    }
+
+    static void destroy_entity(Block_entity &entity){
+        for (const Block_mirror &mirror: entity.mirrors) Mirror::destroy(mirror.texture_ID);
+    }
+};
+#endif
@@ -0,0 +1,37 @@
+#ifndef BLOCK_REGISTRY_H
+#define BLOCK_REGISTRY_H
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+class Block_registry{ // Properties of the block types, indexed by block ID, 0 being air. Each property is its own array so that a loop over block IDs only reads the ones it uses
+    // Chunks, saves and journals only store block IDs, which are given in registration order and don't depend on the GL objects used to draw them
+public:
+    static inline std::vector<std::string> names = {"air"};
+    static inline std::vector<unsigned int> textures = {0}; // GL texture of each block type
+    static inline std::vector<float> shininess = {0.0f}; // Amount of specular light reflected
+    static inline std::vector<uint8_t> opaque = {false}; // Whether the block hides the faces of the blocks behind it (bytes rather than a std::vector<bool> of bits)
+    static inline std::vector<uint8_t> transparent = {true}; // Whether the block is drawn blended, after the opaque ones
+    static inline std::vector<uint8_t> emissive = {false}; // Whether the block emits light
+
+    static uint8_t add(std::string name, unsigned int texture, float shininess, bool opaque, bool emissive){ // Registers a block type and returns its block ID, or air if all 255 IDs are used
+        if (names.size() == 256){
+            std::cout << "Too many block types, " << name << " is not registered" << std::endl;
+            return 0;
+        }
+        names.push_back(name);
+        textures.push_back(texture);
+        Block_registry::shininess.push_back(shininess);
+        Block_registry::opaque.push_back(opaque);
+        transparent.push_back(!opaque);
+        Block_registry::emissive.push_back(emissive);
+        return names.size() - 1;
+    }
+
+    static int size(){ // Number of block IDs, air included
+        return names.size();
+    }
+};
+#endif
@@ -17,6 +17,7 @@ public:
     glm::vec3 camera_front; // Direction from camera to object (z points to us)
     glm::vec3 movement_front; // Direction in which the user is moving when moving forward (i.e. taking into account yaw but not pitch)
     glm::vec3 movement_up;
+    glm::vec3 velocity; // Average velocity over the last frames in blocks per s, from the moves given to update_position
     float camera_speed;
 
     Camera(float camera_speed){
@@ -27,6 +28,8 @@ public:
         camera_front = glm::vec3(0.0f, 0.0f, -1.0f); // By convention z axis is facing towards us
         movement_front = glm::vec3(0.0f, 0.0f, -1.0f);
         movement_up = glm::vec3(0.0f, 1.0f,  0.0f);
+        velocity = glm::vec3(0.0f);
+        frame_movement = glm::vec3(0.0f);
 
         this->camera_speed = camera_speed;
     }
@@ -55,39 +58,18 @@ public:
     }
 
     void update_position(glm::vec3 new_position){ // Called after get_new_position and checking that the new position is valid
+        frame_movement += new_position - camera_pos;
         camera_pos = new_position;
     }
 
-    glm::vec4 unproject_2D_coord(){
-         // Un-projects the 2D cordinate corresponding to the middle of the screen towards its 3D position
-         // First 3 components of output is the 3D object coordinates, and 4th is its depth
-         glm::vec4 viewport = glm::vec4(0, 0, Window::width, Window::height);
-
-         // Retrieve depth of clicked point
-         float x = Window::width/2, y = Window::height/2; // We always click on the middle of the window
-         float* data = (float*)calloc(1, sizeof(float));
-         glReadPixels(x, y, 1, 1, GL_DEPTH_COMPONENT, GL_FLOAT, (void*)data); // Get depth corresponding to clicked point
-         float depth = *data; // Value from depth buffer is a non-linear depth (depth is stored more precisely when smaller)
-         glm::vec3 screen_coord = glm::vec3(x, Window::height-y-1, depth);
-
-         // Re-create view and projection matrices
-         glm::mat4 view = glm::lookAt(Camera::camera_pos, Camera::camera_pos+Camera::camera_front, Camera::movement_up);
-         glm::mat4 projection = glm::mat4(1.0f);
-         float near = Window::near, far = Window::far;
-         projection = glm::perspective(glm::radians(45.0f), (float)Window::width/(float)Window::height, near, far);
-
-         // Use view and projection matrices to un-project clicked point and get their 3D coordinates
-         glm::vec3 object_coord = glm::unProject(screen_coord, view, projection, viewport);
-         float depth_linear = near*far/(far+depth*(near-far)); // Transform back the non-linear depth into a linear one
-         // Formula used by OpenGL to compute the non-linear depth "depth" from linear one "z" is
-         // depth = (1/z - 1/near)/(1/far - 1/near) (source: https://learnopengl.com/Advanced-OpenGL/Depth-testing)
-         // Therefore the opposite formula is
-         // z = (depth*(1/far-1/near)+1/near)^(-1) = (depth/far + (1-depth)/near)^(-1) = ((near*depth + far - far*depth)/(far*near))^(-1)
-         // z = near*far/(far + depth*(near-far))
-         return glm::vec4(object_coord, depth_linear);
-     }
+    void update_velocity(float delta_time){ // Called once per frame after the moves of the frame. The velocity is smoothed over about 10 frames so that it doesn't flicker between keys
+        if (delta_time > 0.0f) velocity = glm::mix(velocity, frame_movement/delta_time, 0.1f);
+        frame_movement = glm::vec3(0.0f);
+    }
 
 private:
+    glm::vec3 frame_movement; // Sum of the moves since the last call to update_velocity
+
     void update_camera_front(){ // Update camera_front according to yaw and pitch
         glm::vec3 direction_yaw_pitch; // Take into account both the pitch and the yaw for camera orientation
         direction_yaw_pitch.x = cos(glm::radians(yaw)) * cos(glm::radians(pitch));
@@ -0,0 +1,369 @@
+#ifndef CHUNK_H
+#define CHUNK_H
+
+#include <iostream>
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <atomic>
+#include <algorithm>
+#include <bitset>
+
+class Chunk{
+public:
+    static inline const int size = 16; // A chunk contains size x size x size blocks
+    static inline const int volume = size*size*size;
+    static inline const uint8_t air = 0; // Block ID of an empty cell, other IDs are block types of Block_registry
+
+    int chunk_x, chunk_y, chunk_z; // Coordinates of the chunk (in number of chunks, block (x,y,z) is in chunk (floor(x/size), floor(y/size), floor(z/size)))
+    int num_blocks; // Number of non-air blocks in the chunk
+    static inline std::atomic<long long> num_copies_on_write{0}; // Number of times set had to copy blocks shared with a snapshot
+
+    Chunk(int chunk_x, int chunk_y, int chunk_z){
+        this->chunk_x = chunk_x;
+        this->chunk_y = chunk_y;
+        this->chunk_z = chunk_z;
+        num_blocks = 0;
+        blocks = std::make_shared<Blocks>();
+        blocks->palette = {air}; // A new chunk is only made of air, which needs 0 bits per block
+        blocks->palette_counts = {volume};
+        blocks->bits_per_block = 0;
+    }
+
+    // Copying a chunk is cheap: the copy shares the blocks of the original, and whichever of the two is modified first copies them (copy-on-write)
+    // A copy can therefore be used as a snapshot, e.g. read by another thread to save it while the original keeps being edited
+
+    uint8_t get(int x, int y, int z) const { // Returns the block ID at local coordinates (x,y,z), each being in [0, size)
+        return blocks->palette[read_index(index(x, y, z))];
+    }
+
+    void set(int x, int y, int z, uint8_t block){ // Sets the block ID at local coordinates (x,y,z), each being in [0, size)
+        int i = index(x, y, z);
+        int old_palette_index = read_index(i);
+        uint8_t current = blocks->palette[old_palette_index];
+        if (current == block) return;
+        if (current == air) num_blocks++;
+        else if (block == air) num_blocks--;
+
+        make_unique_blocks();
+        blocks->palette_counts[old_palette_index]--;
+        int palette_index = find_or_add_in_palette(block); // Might widen the indices
+        blocks->palette_counts[palette_index]++;
+        write_index(i, palette_index);
+    }
+
+    bool empty() const {
+        return num_blocks == 0;
+    }
+
+    bool contains(uint8_t block) const { // Whether at least one block of the chunk is block
+        int palette_index = palette_index_of(block);
+        return palette_index != -1 && blocks->palette_counts[palette_index] > 0;
+    }
+
+    int uniform_block() const { // Block ID of all the blocks of the chunk if they are the same, -1 otherwise
+        for (int i = 0; i < blocks->palette.size(); i++) if (blocks->palette_counts[i] == volume) return blocks->palette[i];
+        return -1;
+    }
+
+    void get_row(int y, int z, uint8_t* row) const { // Copies the size blocks (0, y, z) to (size-1, y, z) to row, decoding their indices from whole words
+        int bits_per_block = blocks->bits_per_block;
+        if (bits_per_block == 0){
+            std::memset(row, blocks->palette[0], size);
+            return;
+        }
+        const uint8_t* palette = blocks->palette.data();
+        int bit = index(0, y, z)*bits_per_block; // Rows start on a word boundary or fill part of one (size*bits_per_block is a multiple or divisor of 64)
+        uint64_t mask = ((uint64_t)1 << bits_per_block) - 1;
+        for (int x = 0; x < size; bit += 64){
+            uint64_t word = blocks->indices[bit >> 6] >> (bit & 63);
+            for (int i = 0; i < 64/bits_per_block && x < size; i++, x++, word >>= bits_per_block) row[x] = palette[word & mask];
+        }
+    }
+
+    // Bulk edits of a box of local coordinates [x0, x1] x [y0, y1] x [z0, z1] (bounds included). They write the packed indices directly, whole words at a time
+    // when possible, and count the palette once at the end instead of once per block
+    void fill(int x0, int y0, int z0, int x1, int y1, int z1, uint8_t block){ // Sets all the blocks of the box to block
+        if (x0 == 0 && y0 == 0 && z0 == 0 && x1 == size-1 && y1 == size-1 && z1 == size-1){ // Whole chunk: a single palette entry
+            blocks = std::make_shared<Blocks>();
+            blocks->palette = {block};
+            blocks->palette_counts = {volume};
+            blocks->bits_per_block = 0;
+            num_blocks = block == air ? 0 : volume;
+            return;
+        }
+        fill_rows(block, [&](int y, int z, int &row_x0, int &row_x1){
+            row_x0 = x0;
+            row_x1 = x1;
+            return y >= y0 && y <= y1 && z >= z0 && z <= z1;
+        });
+    }
+
+    template <typename Row_range> void fill_rows(uint8_t block, Row_range row_range){ // Sets block on [row_x0, row_x1] for the rows (y, z) for which row_range(y, z, row_x0, row_x1) returns true
+        make_unique_blocks();
+        int palette_index = find_or_add_in_palette(block);
+        blocks->palette_counts[palette_index]++; // Not reusable by find_or_add_in_palette until recount
+        int bits_per_block = blocks->bits_per_block;
+        uint64_t pattern = bits_per_block == 0 ? 0 : palette_index * (~(uint64_t)0 / (((uint64_t)1 << bits_per_block) - 1)); // palette_index repeated in all the indices of a word
+        for (int y = 0; y < size; y++){
+            for (int z = 0; z < size; z++){
+                int row_x0, row_x1;
+                if (!row_range(y, z, row_x0, row_x1) || row_x0 > row_x1) continue;
+                write_run(index(row_x0, y, z), row_x1 - row_x0 + 1, pattern);
+            }
+        }
+        recount();
+    }
+
+    void replace(int x0, int y0, int z0, int x1, int y1, int z1, uint8_t from, uint8_t to){ // Replaces the blocks from of the box by to
+        int from_index = palette_index_of(from), to_index = palette_index_of(to);
+        if (from_index == -1 || from == to || blocks->palette_counts[from_index] == 0) return;
+        if (x0 == 0 && y0 == 0 && z0 == 0 && x1 == size-1 && y1 == size-1 && z1 == size-1 && to_index == -1){ // Whole chunk and to isn't in the palette: only the palette changes
+            make_unique_blocks();
+            blocks->palette[from_index] = to;
+            if (from == air) num_blocks += blocks->palette_counts[from_index];
+            else if (to == air) num_blocks -= blocks->palette_counts[from_index];
+            return;
+        }
+        make_unique_blocks();
+        to_index = find_or_add_in_palette(to); // Might widen, which keeps the palette indices
+        blocks->palette_counts[to_index]++;
+        uint64_t ones = ~(uint64_t)0 / (((uint64_t)1 << blocks->bits_per_block) - 1); // Lowest bit of each index, at least 2 palette entries so at least 1 bit per block
+        for (int y = y0; y <= y1; y++){
+            for (int z = z0; z <= z1; z++) replace_run(index(x0, y, z), x1 - x0 + 1, from_index*ones, to_index*ones);
+        }
+        recount();
+    }
+
+    template <typename Block_at> void paste(int x0, int y0, int z0, int x1, int y1, int z1, Block_at block_at){ // Sets each block (x,y,z) of the box to block_at(x, y, z)
+        make_unique_blocks();
+        int palette_indices[256]; // Palette index of each block ID met so far, -1 if not looked up yet
+        std::fill(palette_indices, palette_indices + 256, -1);
+        for (int y = y0; y <= y1; y++){
+            for (int z = z0; z <= z1; z++){
+                for (int x = x0; x <= x1; x++){
+                    uint8_t block = block_at(x, y, z);
+                    if (palette_indices[block] == -1){
+                        palette_indices[block] = find_or_add_in_palette(block);
+                        blocks->palette_counts[palette_indices[block]]++;
+                    }
+                    write_index(index(x, y, z), palette_indices[block]);
+                }
+            }
+        }
+        recount();
+    }
+
+    template <typename Function> void for_each_block(Function function) const { // Calls function(x, y, z, block) with world coordinates for all non-air blocks of the chunk
+        if (empty()) return;
+        for (int y = 0; y < size; y++){
+            for (int z = 0; z < size; z++){
+                for (int x = 0; x < size; x++){
+                    uint8_t block = blocks->palette[read_index(index(x, y, z))];
+                    if (block != air) function(chunk_x*size + x, chunk_y*size + y, chunk_z*size + z, block);
+                }
+            }
+        }
+    }
+
+    int get_bits_per_block() const {
+        return blocks->bits_per_block;
+    }
+
+    int get_palette_size() const {
+        return blocks->palette.size();
+    }
+
+    bool shares_blocks() const { // Whether a copy of the chunk still uses the same blocks, in which case the next set copies them
+        return blocks.use_count() > 1;
+    }
+
+    void write(std::vector<uint8_t> &bytes) const { // Appends the chunk to bytes in a compact binary form (its palette and packed indices as they are in memory)
+        // bits_per_block (1 byte), palette size (2 bytes), palette (1 byte per entry), palette counts (2 bytes per entry), indices
+        const Blocks &b = *blocks;
+        bytes.push_back(b.bits_per_block);
+        append(bytes, (uint16_t)b.palette.size());
+        bytes.insert(bytes.end(), b.palette.begin(), b.palette.end());
+        for (int count: b.palette_counts) append(bytes, (uint16_t)count);
+        const uint8_t* words = (const uint8_t*)b.indices.data();
+        bytes.insert(bytes.end(), words, words + b.indices.size()*sizeof(uint64_t));
+    }
+
+    bool read(const uint8_t* bytes, int num_bytes){ // Replaces the blocks of the chunk by the ones written by write, returns false (leaving the chunk unchanged) if the data is invalid
+        // Besides the sizes, every index must be in the palette and the palette counts must be the numbers of indices, so that a corrupted chunk is never used
+        if (num_bytes < 3) return false;
+        int new_bits_per_block = bytes[0];
+        int palette_size = bytes[1] | (bytes[2] << 8);
+        int num_words = volume*new_bits_per_block/64;
+        if ((new_bits_per_block != 0 && new_bits_per_block != 1 && new_bits_per_block != 2 && new_bits_per_block != 4 && new_bits_per_block != 8) ||
+            palette_size == 0 || palette_size > (1 << new_bits_per_block) || num_bytes != 3 + 3*palette_size + num_words*(int)sizeof(uint64_t)) return false;
+        std::shared_ptr<Blocks> new_blocks = std::make_shared<Blocks>(); // Never written into the blocks shared with a snapshot
+        new_blocks->bits_per_block = new_bits_per_block;
+        new_blocks->palette.assign(bytes + 3, bytes + 3 + palette_size);
+        new_blocks->palette_counts.resize(palette_size);
+        for (int i = 0; i < palette_size; i++) new_blocks->palette_counts[i] = bytes[3 + palette_size + 2*i] | (bytes[3 + palette_size + 2*i + 1] << 8);
+        new_blocks->indices.resize(num_words);
+        if (num_words > 0) memcpy(new_blocks->indices.data(), bytes + 3 + 3*palette_size, num_words*sizeof(uint64_t)); // Little-endian like in memory
+
+        std::vector<int> counts(palette_size, 0);
+        if (new_bits_per_block == 0) counts[0] = volume;
+        else for (int i = 0; i < volume; i++){
+            int bit = i*new_bits_per_block;
+            int palette_index = (new_blocks->indices[bit >> 6] >> (bit & 63)) & ((1 << new_bits_per_block) - 1);
+            if (palette_index >= palette_size) return false;
+            counts[palette_index]++;
+        }
+        if (counts != new_blocks->palette_counts) return false;
+        blocks = new_blocks;
+        num_blocks = volume;
+        for (int i = 0; i < palette_size; i++) if (blocks->palette[i] == air) num_blocks -= blocks->palette_counts[i];
+        return true;
+    }
+
+    int memory_bytes() const { // Memory used by the chunk, including its palette and packed indices (counted in full even if they are shared with a snapshot)
+        return sizeof(Chunk) + sizeof(Blocks) + blocks->palette.capacity()*sizeof(uint8_t) + blocks->palette_counts.capacity()*sizeof(int) + blocks->indices.capacity()*sizeof(uint64_t);
+    }
+
+private:
+    // Blocks are stored as indices in a small palette of the block IDs present in the chunk, packed on bits_per_block bits each
+    // bits_per_block is 0 (a single block ID for the whole chunk), 1, 2, 4 or 8, and is widened when a new block ID doesn't fit in the palette
+    struct Blocks{
+        std::vector<uint8_t> palette; // Block ID of each palette index
+        std::vector<int> palette_counts; // Number of blocks of the chunk using each palette index (entries at 0 can be reused)
+        std::vector<uint64_t> indices; // Packed palette indices, x varying fastest then z then y
+        int bits_per_block;
+    };
+    std::shared_ptr<Blocks> blocks; // Shared between the copies of the chunk until one of them is modified, never modified while shared
+
+    void make_unique_blocks(){ // Copies the blocks if a snapshot still uses them, before modifying them
+        if (blocks.use_count() > 1){
+            blocks = std::make_shared<Blocks>(*blocks);
+            num_copies_on_write++;
+        }
+        else std::atomic_thread_fence(std::memory_order_acquire); // The last snapshot may have just been released by another thread, its reads happen before our writes
+    }
+
+    static void append(std::vector<uint8_t> &bytes, uint16_t value){ // Little-endian
+        bytes.push_back(value & 0xFF);
+        bytes.push_back(value >> 8);
+    }
+
+    static int index(int x, int y, int z){
+        return x + size*(z + size*y);
+    }
+
+    int palette_index_of(uint8_t block) const { // -1 if block isn't in the palette
+        for (int i = 0; i < blocks->palette.size(); i++) if (blocks->palette[i] == block) return i;
+        return -1;
+    }
+
+    void write_run(int first, int count, uint64_t pattern){ // Writes the indices [first, first+count) from pattern, a word of the same index repeated, masking whole words
+        int bits_per_block = blocks->bits_per_block;
+        if (bits_per_block == 0) return;
+        int bit = first*bits_per_block, end_bit = (first + count)*bits_per_block;
+        while (bit < end_bit){
+            int low = bit & 63, num_bits = std::min(64 - low, end_bit - bit);
+            uint64_t mask = (num_bits == 64 ? ~(uint64_t)0 : (((uint64_t)1 << num_bits) - 1)) << low;
+            uint64_t &word = blocks->indices[bit >> 6];
+            word = (word & ~mask) | (pattern & mask);
+            bit += num_bits;
+        }
+    }
+
+    void replace_run(int first, int count, uint64_t from_pattern, uint64_t to_pattern){ // Same as write_run, only for the indices equal to the ones of from_pattern, compared a word at a time (SWAR)
+        int bits_per_block = blocks->bits_per_block;
+        uint64_t ones = ~(uint64_t)0 / (((uint64_t)1 << bits_per_block) - 1), index_mask = ((uint64_t)1 << bits_per_block) - 1;
+        int bit = first*bits_per_block, end_bit = (first + count)*bits_per_block;
+        while (bit < end_bit){
+            int low = bit & 63, num_bits = std::min(64 - low, end_bit - bit);
+            uint64_t mask = (num_bits == 64 ? ~(uint64_t)0 : (((uint64_t)1 << num_bits) - 1)) << low;
+            uint64_t &word = blocks->indices[bit >> 6];
+            uint64_t different = word ^ from_pattern; // Same as in recount
+            for (int shift = 1; shift < bits_per_block; shift *= 2) different |= different >> shift;
+            uint64_t selected = (~different & ones & mask) * index_mask; // All the bits of the indices equal to from, no carry between indices
+            word = (word & ~selected) | (to_pattern & selected);
+            bit += num_bits;
+        }
+    }
+
+    static int popcount(uint64_t bits){ // Number of bits set, with the instruction of the compilers that have it
+#if defined(__GNUC__)
+        return __builtin_popcountll(bits);
+#else
+        return (int)std::bitset<64>(bits).count();
+#endif
+    }
+
+    void recount(){ // Recomputes palette_counts and num_blocks after bulk edits
+        std::vector<int> &palette_counts = blocks->palette_counts;
+        std::fill(palette_counts.begin(), palette_counts.end(), 0);
+        int bits_per_block = blocks->bits_per_block;
+        if (bits_per_block == 0) palette_counts[0] = volume;
+        else if (palette_counts.size()*blocks->indices.size() < volume){ // Small palette: count the indices equal to each palette index a word at a time (SWAR)
+            uint64_t ones = ~(uint64_t)0 / (((uint64_t)1 << bits_per_block) - 1); // Lowest bit of each index
+            for (int palette_index = 0; palette_index < palette_counts.size(); palette_index++){
+                uint64_t pattern = palette_index*ones;
+                int count = 0;
+                for (uint64_t word: blocks->indices){
+                    uint64_t different = word ^ pattern; // Non-zero indices where the index isn't palette_index
+                    for (int shift = 1; shift < bits_per_block; shift *= 2) different |= different >> shift; // Or of the bits of each index in its lowest bit
+                    count += 64/bits_per_block - popcount(different & ones);
+                }
+                palette_counts[palette_index] = count;
+            }
+        }
+        else for (int i = 0; i < volume; i++) palette_counts[read_index(i)]++;
+        num_blocks = volume;
+        for (int i = 0; i < palette_counts.size(); i++) if (blocks->palette[i] == air) num_blocks -= palette_counts[i];
+    }
+
+    int read_index(int i) const { // Palette index of block i. With a power of 2 bits per block, an index never straddles two words
+        int bits_per_block = blocks->bits_per_block;
+        if (bits_per_block == 0) return 0;
+        int bit = i*bits_per_block;
+        return (blocks->indices[bit >> 6] >> (bit & 63)) & ((1 << bits_per_block) - 1);
+    }
+
+    void write_index(int i, int palette_index){
+        int bits_per_block = blocks->bits_per_block;
+        if (bits_per_block == 0) return; // palette_index is necessarily 0
+        int bit = i*bits_per_block;
+        uint64_t mask = (uint64_t)((1 << bits_per_block) - 1) << (bit & 63);
+        blocks->indices[bit >> 6] = (blocks->indices[bit >> 6] & ~mask) | ((uint64_t)palette_index << (bit & 63));
+    }
+
+    int find_or_add_in_palette(uint8_t block){
+        std::vector<uint8_t> &palette = blocks->palette;
+        std::vector<int> &palette_counts = blocks->palette_counts;
+        int free_index = -1;
+        for (int i = 0; i < palette.size(); i++){
+            if (palette[i] == block) return i;
+            if (palette_counts[i] == 0 && free_index == -1) free_index = i;
+        }
+        if (free_index != -1){ // Re-use the entry of a block ID that isn't in the chunk anymore
+            palette[free_index] = block;
+            return free_index;
+        }
+        if (palette.size() == (1 << blocks->bits_per_block)) widen(); // The indices are too small to address one more palette entry
+        palette.push_back(block);
+        palette_counts.push_back(0);
+        return palette.size()-1;
+    }
+
+    void widen(){ // Doubles the number of bits per block (0 becomes 1) and re-packs the indices
+        int new_bits_per_block = blocks->bits_per_block == 0 ? 1 : 2*blocks->bits_per_block;
+        std::vector<int> unpacked(volume);
+        for (int i = 0; i < volume; i++) unpacked[i] = read_index(i);
+        blocks->bits_per_block = new_bits_per_block;
+        blocks->indices.assign(volume*new_bits_per_block/64, 0);
+        for (int i = 0; i < volume; i++) write_index(i, unpacked[i]);
+    }
+};
+
+struct Chunk_column{ // Chunks of one column (same chunk_x and chunk_z), e.g. when generating, loading or saving them
+    int chunk_x, chunk_z;
+    std::vector<Chunk> chunks;
+};
+#endif
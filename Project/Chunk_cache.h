@@ -0,0 +1,152 @@
+#ifndef CHUNK_CACHE_H
+#define CHUNK_CACHE_H
+
+#include <iostream>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+#include "Chunk.h"
+
+class Chunk_cache{ // In-memory tier between the loaded chunks and the save: columns unloaded from the world are kept here run-length encoded, so that coming back to them
+    // doesn't read the disk or generate them again. Columns are dropped when over the memory budget, the farthest from the camera first then the least recently unloaded
+    // Modified columns are saved when they are unloaded, so dropping a column never loses edits. Used by the main thread and by the I/O threads of Chunk_streamer
+public:
+    std::atomic<long long> hits{0}, misses{0}, evicted_chunks{0}; // Statistics since they were last reset: columns found or not by take, and chunks dropped by evict
+
+    void put(const Chunk_column &column){ // Adds a column unloaded from the world, replacing the cached one if any
+        Cached_column cached;
+        cached.chunk_x = column.chunk_x;
+        cached.chunk_z = column.chunk_z;
+        for (const Chunk &chunk: column.chunks){
+            cached.chunk_ys.push_back(chunk.chunk_y);
+            cached.offsets.push_back(cached.bytes.size());
+            compress(chunk, cached.bytes);
+        }
+        cached.bytes.shrink_to_fit();
+        std::lock_guard<std::mutex> lock(mutex);
+        cached.last_use = ++clock;
+        std::pair<int, int> coordinates(column.chunk_x, column.chunk_z);
+        auto it = columns.find(coordinates);
+        if (it != columns.end()) remove(it);
+        num_bytes += cached.memory_bytes();
+        num_chunks += cached.chunk_ys.size();
+        columns[coordinates] = std::move(cached);
+    }
+
+    bool take(int chunk_x, int chunk_z, Chunk_column &column){ // Removes a column from the cache to load it in the world, returns false if it isn't cached
+        Cached_column cached;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = columns.find(std::make_pair(chunk_x, chunk_z));
+            if (it == columns.end()){
+                misses++;
+                return false;
+            }
+            hits++;
+            num_bytes -= it->second.memory_bytes();
+            num_chunks -= it->second.chunk_ys.size();
+            cached = std::move(it->second);
+            columns.erase(it);
+        }
+        column.chunk_x = chunk_x;
+        column.chunk_z = chunk_z;
+        column.chunks.clear();
+        for (int i = 0; i < cached.chunk_ys.size(); i++){ // Decompressed outside of the lock
+            column.chunks.push_back(Chunk(chunk_x, cached.chunk_ys[i], chunk_z));
+            decompress(&cached.bytes[cached.offsets[i]], column.chunks.back());
+        }
+        return true;
+    }
+
+    void evict(long long budget_bytes, int center_x, int center_z){ // Drops columns until the cache uses at most budget_bytes, the farthest from column (center_x, center_z) first
+        std::lock_guard<std::mutex> lock(mutex);
+        if (num_bytes <= budget_bytes) return;
+        std::vector<std::pair<std::pair<long long, long long>, std::pair<int, int>>> order; // ((distance, -last use), coordinates), sorted with the first to drop last
+        for (auto &pair: columns){
+            long long dx = pair.first.first - center_x, dz = pair.first.second - center_z;
+            order.push_back(std::make_pair(std::make_pair(dx*dx + dz*dz, -pair.second.last_use), pair.first));
+        }
+        std::sort(order.begin(), order.end());
+        while (num_bytes > budget_bytes && !order.empty()){
+            auto it = columns.find(order.back().second);
+            order.pop_back();
+            evicted_chunks += it->second.chunk_ys.size();
+            remove(it);
+        }
+    }
+
+    long long memory_bytes(){ // Memory used by the cached columns
+        std::lock_guard<std::mutex> lock(mutex);
+        return num_bytes;
+    }
+
+    long long num_cached_chunks(){
+        std::lock_guard<std::mutex> lock(mutex);
+        return num_chunks;
+    }
+
+    static void compress(const Chunk &chunk, std::vector<uint8_t> &bytes){ // Appends the blocks of the chunk as runs of (block ID, length-1) in the order x, z then y, a run being at most 256 blocks
+        // Terrain chunks are made of long horizontal runs of air, dirt or grass, so this is usually much smaller than the palette indices
+        uint8_t run_block = chunk.get(0, 0, 0);
+        int run_length = 0;
+        for (int y = 0; y < Chunk::size; y++){
+            for (int z = 0; z < Chunk::size; z++){
+                for (int x = 0; x < Chunk::size; x++){
+                    uint8_t block = chunk.get(x, y, z);
+                    if (block != run_block || run_length == 256){
+                        bytes.push_back(run_block);
+                        bytes.push_back(run_length - 1);
+                        run_block = block;
+                        run_length = 0;
+                    }
+                    run_length++;
+                }
+            }
+        }
+        bytes.push_back(run_block);
+        bytes.push_back(run_length - 1);
+    }
+
+    static void decompress(const uint8_t* bytes, Chunk &chunk){ // Fills an empty chunk from the runs written by compress
+        int i = 0;
+        while (i < Chunk::volume){
+            uint8_t block = bytes[0];
+            int run_length = bytes[1] + 1;
+            bytes += 2;
+            if (block == Chunk::air){
+                i += run_length;
+                continue;
+            }
+            for (int end = i + run_length; i < end; i++) chunk.set(i % Chunk::size, i / (Chunk::size*Chunk::size), (i / Chunk::size) % Chunk::size, block);
+        }
+    }
+
+private:
+    struct Cached_column{
+        int chunk_x, chunk_z;
+        std::vector<int> chunk_ys; // chunk_y of each chunk
+        std::vector<int> offsets; // Start of each chunk in bytes
+        std::vector<uint8_t> bytes; // Runs of all the chunks
+        long long last_use; // Value of clock when it was put
+
+        long long memory_bytes() const {
+            return sizeof(Cached_column) + chunk_ys.capacity()*sizeof(int) + offsets.capacity()*sizeof(int) + bytes.capacity();
+        }
+    };
+
+    std::mutex mutex; // Protects the members below
+    std::map<std::pair<int, int>, Cached_column> columns; // Keyed by (chunk_x, chunk_z)
+    long long num_bytes = 0; // Memory used by columns
+    long long num_chunks = 0;
+    long long clock = 0;
+
+    void remove(std::map<std::pair<int, int>, Cached_column>::iterator it){
+        num_bytes -= it->second.memory_bytes();
+        num_chunks -= it->second.chunk_ys.size();
+        columns.erase(it);
+    }
+};
+#endif
@@ -0,0 +1,72 @@
+#ifndef CHUNK_CONNECTIVITY_H
+#define CHUNK_CONNECTIVITY_H
+
+#include <array>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "Chunk.h"
+
+class Chunk_connectivity{ // Which faces of a chunk are connected by paths of non-opaque blocks, so that the chunks only seen through opaque ones can be skipped
+public:
+    enum Face{negative_x, positive_x, negative_y, positive_y, negative_z, positive_z, num_faces}; // The opposite of face f is f^1
+    uint8_t links[num_faces] = {}; // Bit g of links[f] is set if a path of non-opaque blocks goes from face f to face g
+
+    static Chunk_connectivity all_connected(){ // Connectivity of an empty chunk
+        Chunk_connectivity connectivity;
+        for (int face = 0; face < num_faces; face++) connectivity.links[face] = (1 << num_faces) - 1;
+        return connectivity;
+    }
+
+    static glm::ivec3 direction(int face){ // Offset from a chunk to its neighbour through face
+        glm::ivec3 offset(0);
+        offset[face/2] = (face & 1) ? 1 : -1;
+        return offset;
+    }
+
+    static Chunk_connectivity compute(const Chunk &chunk, const std::array<bool, 256> &opaque){
+        // Flood fills each group of connected non-opaque blocks and connects together all the faces of the chunk that the group touches
+        if (chunk.empty()) return all_connected();
+        const int size = Chunk::size;
+        std::array<uint8_t, Chunk::volume> closed; // Opaque or already filled, indexed by x + size*(y + size*z)
+        int num_open = 0;
+        for (int z = 0; z < size; z++){
+            for (int y = 0; y < size; y++){
+                for (int x = 0; x < size; x++){
+                    closed[x + size*(y + size*z)] = opaque[chunk.get(x, y, z)];
+                    num_open += !opaque[chunk.get(x, y, z)];
+                }
+            }
+        }
+        Chunk_connectivity connectivity;
+        if (num_open == 0) return connectivity;
+
+        std::array<uint16_t, Chunk::volume> stack;
+        for (int start = 0; start < Chunk::volume; start++){
+            if (closed[start]) continue;
+            closed[start] = true;
+            int stack_size = 0;
+            stack[stack_size++] = start;
+            uint8_t faces = 0; // Faces touched by the group
+            while (stack_size > 0){
+                int i = stack[--stack_size];
+                int x = i % size, y = (i / size) % size, z = i / (size*size);
+                int coords[3] = {x, y, z}, steps[3] = {1, size, size*size};
+                for (int axis = 0; axis < 3; axis++){
+                    if (coords[axis] == 0) faces |= 1 << (2*axis);
+                    else if (!closed[i - steps[axis]]){
+                        closed[i - steps[axis]] = true;
+                        stack[stack_size++] = i - steps[axis];
+                    }
+                    if (coords[axis] == size-1) faces |= 1 << (2*axis + 1);
+                    else if (!closed[i + steps[axis]]){
+                        closed[i + steps[axis]] = true;
+                        stack[stack_size++] = i + steps[axis];
+                    }
+                }
+            }
+            for (int face = 0; face < num_faces; face++) if (faces & (1 << face)) connectivity.links[face] |= faces;
+        }
+        return connectivity;
+    }
+};
+#endif
@@ -0,0 +1,77 @@
+#ifndef CHUNK_MESH_H
+#define CHUNK_MESH_H
+
+#include <iostream>
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include "Chunk_mesher.h"
+#include "Occlusion_buffer.h"
+#include "Chunk_connectivity.h"
+
+class Chunk_mesh{ // Vertex and index buffers of the mesh of one chunk on the GPU
+public:
+    std::vector<Chunk_mesh_range> ranges; // Indices to draw for each block ID
+    int num_triangles = 0;
+    int lod_scale = 1; // Size in blocks of the cells the mesh was built from (see Chunk_mesher::mesh_chunk_lod)
+    uint8_t air_sides = 0; // Sides meshed as if their neighbours were air (see Chunk_mesher::mesh_chunk)
+    Chunk_connectivity connectivity = Chunk_connectivity::all_connected(); // Faces of the chunk connected through its non-opaque blocks
+    std::vector<Occluder_box> occluders; // Boxes of opaque blocks of the chunk, drawn in the occlusion buffer when the chunk is close to the camera
+
+    void upload(Chunk_mesh_data &data){ // Replaces the content of the buffers by the given mesh, re-using the same buffers
+        if (VAO == 0) generate_VAO();
+        ranges = data.ranges;
+        num_triangles = data.num_triangles();
+
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, data.vertices.size() * sizeof(float), data.vertices.empty() ? NULL : &data.vertices[0], GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, data.indices.size() * sizeof(unsigned int), data.indices.empty() ? NULL : &data.indices[0], GL_STATIC_DRAW);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    int draw_block(uint8_t block){ // Draws the faces of the given block ID (shader and texture must already be bound), returns the number of triangles drawn
+        for (Chunk_mesh_range range: ranges){
+            if (range.block == block) return draw_range(range);
+        }
+        return 0;
+    }
+
+    int draw_range(Chunk_mesh_range range){ // Draws one of ranges (shader and texture must already be bound), returns the number of triangles drawn
+        glBindVertexArray(VAO);
+        glDrawElements(GL_TRIANGLES, range.num_indices, GL_UNSIGNED_INT, (void *) (range.first_index * sizeof(unsigned int)));
+        glBindVertexArray(0);
+        return range.num_indices/3;
+    }
+
+    void destroy(){ // Chunk meshes are copied around, so buffers are only deleted explicitly
+        if (VAO == 0) return;
+        glDeleteVertexArrays(1, &VAO);
+        glDeleteBuffers(1, &VBO);
+        glDeleteBuffers(1, &EBO);
+        VAO = VBO = EBO = 0;
+    }
+
+private:
+    unsigned int VAO = 0, VBO = 0, EBO = 0;
+
+    void generate_VAO(){
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+        glGenBuffers(1, &EBO);
+
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO); // The EBO binding is stored in the VAO
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void *) 0); // Position
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void *) (3 * sizeof(float))); // Normal
+        glEnableVertexAttribArray(1);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+};
+#endif
@@ -0,0 +1,319 @@
+#ifndef CHUNK_MESHER_H
+#define CHUNK_MESHER_H
+
+#include <iostream>
+#include <glm/glm.hpp>
+#include <array>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <chrono>
+#include "Chunk.h"
+#include "World.h"
+#include "Terrain_generator.h"
+
+struct Chunk_mesh_range{ // Indices of a chunk mesh that belong to one block ID, drawn with the texture of this block
+    uint8_t block;
+    int first_index;
+    int num_indices;
+};
+
+struct Chunk_mesh_data{ // Mesh of a chunk computed on the CPU, ready to be sent to the GPU
+    std::vector<float> vertices; // First 3 are 3D positions, final 3 are normal vector components
+    std::vector<unsigned int> indices;
+    std::vector<Chunk_mesh_range> ranges; // One range per block ID present in the mesh
+
+    int num_triangles(){
+        return indices.size()/3;
+    }
+};
+
+struct Chunk_faces{ // Visible faces of the blocks of a chunk
+    // faces[direction][j][i] has bit s set when the block at slice s along axis d, and position (i,j) along axes u=(d+1)%3 and v=(d+2)%3,
+    // has a visible face pointing towards direction, which is 2*d for faces pointing towards -d and 2*d+1 for faces pointing towards +d
+    uint32_t faces[6][Chunk::size][Chunk::size];
+    uint32_t slices[6]; // Bit s is set when slice s has at least one visible face in this direction
+};
+
+class Chunk_mesher{
+public:
+    enum Side{negative_x_side = 1, positive_x_side = 2, negative_z_side = 4, positive_z_side = 8}; // Bits of the sides of a chunk in air_sides
+
+    static Chunk_mesh_data mesh_chunk(World &world, Chunk &chunk, const std::array<bool, 256> &opaque, uint8_t air_sides = 0){
+        // Builds the mesh of the visible faces of the chunk, merging coplanar neighbouring faces of the same block ID into larger quads (greedy meshing)
+        // opaque[block] tells whether a block ID hides the faces of the blocks behind it. The sides in air_sides, against chunks meshed at another scale, are meshed
+        // as if their neighbours were air like the sides of mesh_chunk_lod: a downsampled neighbour can have air where the blocks that would hide these faces are
+        return mesh_cells(padded_blocks(world, chunk, air_sides), chunk, opaque, 1);
+    }
+
+    static Chunk_mesh_data mesh_chunk_lod(World &world, Chunk &chunk, const std::array<bool, 256> &opaque, int scale){
+        // Same as mesh_chunk with the chunk downsampled to cells of scale x scale x scale blocks (scale being 2, 4 or 8), for chunks far from the camera
+        // The cells on the x and z borders are meshed as if their neighbours were air, so that the sides of the chunk close the seams with neighbouring
+        // chunks meshed at another scale (like skirts). Columns are meshed at one scale, so neighbours along y use the actual downsampled cells
+        return mesh_cells(downsampled_blocks(world, chunk, scale), chunk, opaque, scale);
+    }
+
+    static int lod_scale(int distance, int lod_distance){ // Scale of the cells of a chunk column distance chunks away from the camera (see Map::lod_distance)
+        if (lod_distance <= 0 || distance < lod_distance) return 1;
+        if (distance < 2*lod_distance) return 2;
+        if (distance < 4*lod_distance) return 4;
+        return 8;
+    }
+
+    static void benchmark_lod(const Terrain_generator &generator, const std::array<bool, 256> &opaque, int lod_distance){ // Prints the triangles of the chunks within several view distances, meshed at full detail and with levels of detail
+        const int max_radius = 32, radii[] = {4, 8, 16, 24, 32};
+        World world;
+        for (int chunk_x = -max_radius - 1; chunk_x <= max_radius + 1; chunk_x++){ // One more column around so that the border faces are the same as in the game
+            for (int chunk_z = -max_radius - 1; chunk_z <= max_radius + 1; chunk_z++){
+                if (chunk_x*chunk_x + chunk_z*chunk_z > (max_radius + 1)*(max_radius + 1)) continue;
+                for (Chunk &chunk: generator.generate_column(chunk_x, chunk_z)) world.insert_chunk(chunk);
+            }
+        }
+
+        long long full_triangles[5] = {}, lod_triangles[5] = {};
+        double full_time[5] = {}, lod_time[5] = {};
+        for (auto &pair: world.chunks){
+            Chunk &chunk = pair.second;
+            int squared_distance = chunk.chunk_x*chunk.chunk_x + chunk.chunk_z*chunk.chunk_z;
+            if (squared_distance > max_radius*max_radius) continue;
+            int scale = lod_scale(std::max(std::abs(chunk.chunk_x), std::abs(chunk.chunk_z)), lod_distance);
+            auto start = std::chrono::steady_clock::now();
+            int full = mesh_chunk(world, chunk, opaque).num_triangles();
+            auto middle = std::chrono::steady_clock::now();
+            int lod = scale == 1 ? full : mesh_chunk_lod(world, chunk, opaque, scale).num_triangles();
+            double lod_seconds = scale == 1 ? std::chrono::duration<double>(middle - start).count() : std::chrono::duration<double>(std::chrono::steady_clock::now() - middle).count();
+            for (int k = 0; k < 5; k++){
+                if (squared_distance > radii[k]*radii[k]) continue;
+                full_triangles[k] += full;
+                lod_triangles[k] += lod;
+                full_time[k] += std::chrono::duration<double>(middle - start).count();
+                lod_time[k] += lod_seconds;
+            }
+        }
+        std::cout << "Levels of detail from " << lod_distance << " chunks (half resolution), " << 2*lod_distance << " (quarter) and " << 4*lod_distance << " (eighth):" << std::endl;
+        for (int k = 0; k < 5; k++){
+            std::cout << "  view distance " << radii[k]*Chunk::size << " blocks: " << full_triangles[k] << " triangles at full detail (meshed in " << 1000*full_time[k] << " ms), "
+                      << lod_triangles[k] << " with levels of detail (" << 1000*lod_time[k] << " ms)" << std::endl;
+        }
+    }
+
+private:
+    static Chunk_mesh_data mesh_cells(const std::vector<uint8_t> &blocks, Chunk &chunk, const std::array<bool, 256> &opaque, int scale){
+        // Greedy meshing of the padded cells of blocks (see padded_blocks), each cell being a cube of scale blocks
+        const int size = Chunk::size / scale; // Number of cells along each axis
+        std::array<std::vector<float>, 256> vertices_per_block;
+        std::array<std::vector<unsigned int>, 256> indices_per_block;
+        glm::ivec3 origin(chunk.chunk_x*Chunk::size, chunk.chunk_y*Chunk::size, chunk.chunk_z*Chunk::size); // World coordinates of local block (0,0,0)
+
+        Chunk_faces visible = visible_faces(blocks, opaque, size);
+        uint8_t mask[Chunk::size][Chunk::size]; // Block ID of the visible face at each position of the current slice, air if there is none. Only the first size rows and columns are used
+        for (int d = 0; d < 3; d++){ // Axis orthogonal to the faces
+            int u = (d+1)%3, v = (d+2)%3; // Axes of the plane of the faces
+            for (int sign = -1; sign <= 1; sign += 2){ // Faces pointing towards -d or +d
+                int direction = 2*d + (sign > 0);
+                for (int s = 0; s < size; s++){ // Slice along d
+                    if (!(visible.slices[direction] >> s & 1)) continue; // No face to draw in this slice
+                    // Read the visible faces of this slice
+                    for (int j = 0; j < size; j++){
+                        for (int i = 0; i < size; i++){
+                            if (!(visible.faces[direction][j][i] >> s & 1)){
+                                mask[j][i] = Chunk::air;
+                                continue;
+                            }
+                            glm::ivec3 pos;
+                            pos[d] = s;
+                            pos[u] = i;
+                            pos[v] = j;
+                            mask[j][i] = blocks[padded_index(pos)];
+                        }
+                    }
+
+                    // Cover the visible faces with rectangles as large as possible
+                    for (int j = 0; j < size; j++){
+                        for (int i = 0; i < size;){
+                            uint8_t block = mask[j][i];
+                            if (block == Chunk::air){
+                                i++;
+                                continue;
+                            }
+                            int width = 1; // Extend the rectangle along u as long as the faces are the same
+                            while (i + width < size && mask[j][i + width] == block) width++;
+                            int height = 1; // Then extend it along v as long as the whole next row is the same
+                            while (j + height < size){
+                                bool full_row = true;
+                                for (int k = 0; k < width; k++) if (mask[j + height][i + k] != block){
+                                    full_row = false;
+                                    break;
+                                }
+                                if (!full_row) break;
+                                height++;
+                            }
+                            for (int l = 0; l < height; l++) for (int k = 0; k < width; k++) mask[j + l][i + k] = Chunk::air; // These faces are covered
+
+                            glm::vec3 corner; // Corner of the rectangle with the smallest u and v coordinates
+                            corner[d] = origin[d] + (s + (sign > 0))*scale - 0.5f; // Blocks are centered on integer coordinates
+                            corner[u] = origin[u] + i*scale - 0.5f;
+                            corner[v] = origin[v] + j*scale - 0.5f;
+                            glm::vec3 side_u(0.0f), side_v(0.0f), normal(0.0f);
+                            side_u[u] = width*scale;
+                            side_v[v] = height*scale;
+                            normal[d] = sign;
+                            add_quad(vertices_per_block[block], indices_per_block[block], corner, side_u, side_v, normal, sign > 0);
+                            i += width;
+                        }
+                    }
+                }
+            }
+        }
+
+        // Put the quads of all block IDs in the same buffers, one range per block ID
+        Chunk_mesh_data data;
+        for (int block = 1; block < 256; block++){
+            if (indices_per_block[block].empty()) continue;
+            unsigned int first_vertex = data.vertices.size()/6;
+            data.ranges.push_back({(uint8_t)block, (int)data.indices.size(), (int)indices_per_block[block].size()});
+            data.vertices.insert(data.vertices.end(), vertices_per_block[block].begin(), vertices_per_block[block].end());
+            for (unsigned int index: indices_per_block[block]) data.indices.push_back(first_vertex + index);
+        }
+        return data;
+    }
+
+    struct Column_masks{ // Masks of the columns of blocks along each axis, with the same (d, j, i) indexing as Chunk_faces
+        // Bit k+1 is set for the block at coordinate k along the column, k being in [-1, size] to include the neighbouring chunks
+        uint64_t columns[3][Chunk::size][Chunk::size] = {};
+
+        void add(int x, int y, int z, int size){ // Sets the bit of local cell (x,y,z) in the columns going through the chunk, which has size cells along each axis
+            bool inside_x = x >= 0 && x < size, inside_y = y >= 0 && y < size, inside_z = z >= 0 && z < size;
+            if (inside_y && inside_z) columns[0][z][y] |= (uint64_t)1 << (x+1);
+            if (inside_z && inside_x) columns[1][x][z] |= (uint64_t)1 << (y+1);
+            if (inside_x && inside_y) columns[2][y][x] |= (uint64_t)1 << (z+1);
+        }
+    };
+
+    static Chunk_faces visible_faces(const std::vector<uint8_t> &blocks, const std::array<bool, 256> &opaque, int size){
+        // Finds the visible faces with a few bit operations on 64-bit masks of the columns of blocks along each axis, the chunk having size cells along each axis
+        // A face is hidden when the block in front of it is opaque, or is non-opaque and of the same block ID (e.g. two glass blocks side by side)
+        Column_masks solid; // Non-air blocks
+        Column_masks opaque_columns; // Opaque blocks
+        std::vector<uint8_t> transparent_blocks; // Non-opaque block IDs present in and around the chunk
+        std::vector<Column_masks> transparent_columns; // Blocks of each of these block IDs
+
+        for (int y = -1; y <= size; y++){
+            for (int z = -1; z <= size; z++){
+                for (int x = -1; x <= size; x++){
+                    uint8_t block = blocks[padded_index(glm::ivec3(x, y, z))];
+                    if (block == Chunk::air) continue;
+                    solid.add(x, y, z, size);
+                    if (opaque[block]){
+                        opaque_columns.add(x, y, z, size);
+                        continue;
+                    }
+                    int index = std::find(transparent_blocks.begin(), transparent_blocks.end(), block) - transparent_blocks.begin();
+                    if (index == transparent_blocks.size()){
+                        transparent_blocks.push_back(block);
+                        transparent_columns.push_back(Column_masks());
+                    }
+                    transparent_columns[index].add(x, y, z, size);
+                }
+            }
+        }
+
+        Chunk_faces visible;
+        const uint64_t inside = (((uint64_t)1 << size) - 1) << 1; // Bits of the blocks inside the chunk
+        for (int d = 0; d < 3; d++){
+            visible.slices[2*d] = visible.slices[2*d+1] = 0;
+            for (int j = 0; j < size; j++){
+                for (int i = 0; i < size; i++){
+                    // The neighbour towards +d of bit k is bit k+1, so shifting a mask right by 1 puts the neighbours towards +d in front of each block
+                    uint64_t hidden_plus = opaque_columns.columns[d][j][i] >> 1;
+                    uint64_t hidden_minus = opaque_columns.columns[d][j][i] << 1;
+                    for (Column_masks &transparent_column: transparent_columns){
+                        uint64_t same = transparent_column.columns[d][j][i];
+                        hidden_plus |= same & (same >> 1);
+                        hidden_minus |= same & (same << 1);
+                    }
+                    uint64_t column = solid.columns[d][j][i] & inside;
+                    uint32_t faces_minus = (column & ~hidden_minus) >> 1; // Back to bit s for the block at coordinate s
+                    uint32_t faces_plus = (column & ~hidden_plus) >> 1;
+                    visible.faces[2*d][j][i] = faces_minus;
+                    visible.faces[2*d+1][j][i] = faces_plus;
+                    visible.slices[2*d] |= faces_minus;
+                    visible.slices[2*d+1] |= faces_plus;
+                }
+            }
+        }
+        return visible;
+    }
+
+    static std::vector<uint8_t> padded_blocks(World &world, Chunk &chunk, uint8_t air_sides){
+        // Copy of the blocks of the chunk with a border of one block taken from the neighbouring chunks, to know the neighbours of the faces on the chunk borders
+        // The border is left as air on the sides of air_sides
+        const int size = Chunk::size;
+        std::vector<uint8_t> blocks((size+2)*(size+2)*(size+2), Chunk::air);
+        for (int y = -1; y <= size; y++){
+            for (int z = -1; z <= size; z++){
+                for (int x = -1; x <= size; x++){
+                    bool inside = x >= 0 && x < size && y >= 0 && y < size && z >= 0 && z < size;
+                    bool air_side = (x < 0 && (air_sides & negative_x_side)) || (x == size && (air_sides & positive_x_side)) || (z < 0 && (air_sides & negative_z_side)) || (z == size && (air_sides & positive_z_side));
+                    uint8_t block;
+                    if (inside) block = chunk.get(x, y, z);
+                    else if (air_side) block = Chunk::air;
+                    else block = world.get(chunk.chunk_x*size + x, chunk.chunk_y*size + y, chunk.chunk_z*size + z);
+                    blocks[padded_index(glm::ivec3(x, y, z))] = block;
+                }
+            }
+        }
+        return blocks;
+    }
+
+    static std::vector<uint8_t> downsampled_blocks(World &world, Chunk &chunk, int scale){
+        // Padded cells of the chunk (see mesh_chunk_lod): a cell gets the most common block of its blocks if at least half of them are not air
+        const int size = Chunk::size, cells = size / scale;
+        std::vector<uint8_t> blocks((size+2)*(size+2)*(size+2), Chunk::air);
+        Chunk* below = world.get_chunk(chunk.chunk_x, chunk.chunk_y - 1, chunk.chunk_z);
+        Chunk* above = world.get_chunk(chunk.chunk_x, chunk.chunk_y + 1, chunk.chunk_z);
+        std::array<int, 256> counts = {};
+        std::vector<uint8_t> counted; // Block IDs whose count is not 0
+        for (int y = -1; y <= cells; y++){
+            Chunk* source = y < 0 ? below : (y == cells ? above : &chunk);
+            if (source == nullptr) continue;
+            int source_y = y < 0 ? cells - 1 : (y == cells ? 0 : y); // Cell of source along y
+            for (int z = 0; z < cells; z++){
+                for (int x = 0; x < cells; x++){
+                    int num_solid = 0;
+                    for (int k = 0; k < scale*scale*scale; k++){
+                        uint8_t block = source->get(x*scale + k % scale, source_y*scale + k / (scale*scale), z*scale + (k / scale) % scale);
+                        if (block == Chunk::air) continue;
+                        num_solid++;
+                        if (counts[block]++ == 0) counted.push_back(block);
+                    }
+                    uint8_t most_common = Chunk::air;
+                    for (uint8_t block: counted){
+                        if (most_common == Chunk::air || counts[block] > counts[most_common]) most_common = block;
+                    }
+                    for (uint8_t block: counted) counts[block] = 0;
+                    counted.clear();
+                    if (2*num_solid >= scale*scale*scale) blocks[padded_index(glm::ivec3(x, y, z))] = most_common;
+                }
+            }
+        }
+        return blocks;
+    }
+
+    static int padded_index(glm::ivec3 pos){ // Index in the padded array of local coordinates pos, each being in [-1, size]. Downsampled chunks use the same layout with fewer cells
+        const int padded_size = Chunk::size + 2;
+        return (pos.x + 1) + padded_size*((pos.z + 1) + padded_size*(pos.y + 1));
+    }
+
+    static void add_quad(std::vector<float> &vertices, std::vector<unsigned int> &indices, glm::vec3 corner, glm::vec3 side_u, glm::vec3 side_v, glm::vec3 normal, bool positive){
+        unsigned int first = vertices.size()/6;
+        glm::vec3 corners[4] = {corner, corner + side_u, corner + side_u + side_v, corner + side_v};
+        for (glm::vec3 position: corners){
+            vertices.insert(vertices.end(), {position.x, position.y, position.z, normal.x, normal.y, normal.z});
+        }
+        // side_u x side_v points towards +d, so the triangles are counter-clockwise seen from outside when facing +d and reversed otherwise
+        if (positive) indices.insert(indices.end(), {first, first+1, first+2, first, first+2, first+3});
+        else indices.insert(indices.end(), {first, first+2, first+1, first, first+3, first+2});
+    }
+};
+#endif
@@ -0,0 +1,140 @@
+#ifndef CHUNK_STREAMER_H
+#define CHUNK_STREAMER_H
+
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+#include <iterator>
+#include "Chunk.h"
+#include "Terrain_generator.h"
+#include "World_save.h"
+#include "Chunk_cache.h"
+
+class Chunk_streamer{ // Loads chunk columns from the cache or the save on I/O threads, and generates the ones that were never saved on generation threads
+    // Requests and results go through queues protected by a mutex, the world itself is only touched by the main thread, which never waits for the disk
+public:
+    Chunk_streamer(Terrain_generator generator, Chunk_cache* cache, World_save* world_save, int num_io_threads, int num_generation_threads): generator(generator){
+        this->cache = cache;
+        this->world_save = world_save;
+        for (int i = 0; i < num_io_threads; i++) threads.push_back(std::thread(&Chunk_streamer::load, this));
+        for (int i = 0; i < num_generation_threads; i++) threads.push_back(std::thread(&Chunk_streamer::generate, this));
+    }
+
+    ~Chunk_streamer(){
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        io_condition.notify_all();
+        generation_condition.notify_all();
+        for (std::thread &thread: threads) thread.join();
+    }
+
+    void request(int chunk_x, int chunk_z, float priority){ // Queues a column, the requests of lowest priority being served first
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            io_jobs.push_back({chunk_x, chunk_z, priority});
+        }
+        io_condition.notify_one();
+    }
+
+    void reprioritize(std::function<float(int, int)> priority){ // Replaces the priority of the queued columns (chunk_x, chunk_z) by priority(chunk_x, chunk_z), e.g. when the camera moved
+        std::lock_guard<std::mutex> lock(mutex);
+        for (Job &job: io_jobs) job.priority = priority(job.chunk_x, job.chunk_z);
+        for (Job &job: generation_jobs) job.priority = priority(job.chunk_x, job.chunk_z);
+    }
+
+    int cancel(std::function<bool(int, int)> cancelled){ // Removes the queued requests of the columns (chunk_x, chunk_z) for which cancelled returns true, returns their number
+        std::lock_guard<std::mutex> lock(mutex);
+        int num_jobs = io_jobs.size() + generation_jobs.size();
+        for (std::vector<Job>* jobs: {&io_jobs, &generation_jobs}){
+            jobs->erase(std::remove_if(jobs->begin(), jobs->end(), [&](Job &job){ return cancelled(job.chunk_x, job.chunk_z); }), jobs->end());
+        }
+        return num_jobs - io_jobs.size() - generation_jobs.size();
+    }
+
+    std::vector<Chunk_column> take_finished(int max_columns){ // Returns at most max_columns loaded or generated columns, in the order they were finished
+        std::lock_guard<std::mutex> lock(mutex);
+        int num_columns = std::min(max_columns, (int)finished.size());
+        std::vector<Chunk_column> columns(std::make_move_iterator(finished.begin()), std::make_move_iterator(finished.begin() + num_columns));
+        finished.erase(finished.begin(), finished.begin() + num_columns);
+        return columns;
+    }
+
+    int num_pending(){ // Columns requested but not yet taken
+        std::lock_guard<std::mutex> lock(mutex);
+        return io_jobs.size() + generation_jobs.size() + num_working + finished.size();
+    }
+
+private:
+    struct Job{
+        int chunk_x, chunk_z;
+        float priority;
+    };
+
+    Terrain_generator generator;
+    Chunk_cache* cache;
+    World_save* world_save;
+    std::vector<std::thread> threads;
+    std::mutex mutex; // Protects all members below
+    std::condition_variable io_condition; // Signaled when a column is queued in io_jobs or when stopping
+    std::condition_variable generation_condition; // Same for generation_jobs
+    std::vector<Job> io_jobs; // Columns to look for in the save
+    std::vector<Job> generation_jobs; // Columns that are not in the save
+    std::deque<Chunk_column> finished; // Loaded or generated columns
+    int num_working = 0; // Columns being loaded or generated
+    bool stopping = false;
+
+    static Job take_first(std::vector<Job> &jobs){ // Removes the job of lowest priority. There are at most a few hundred jobs, so they are not kept sorted
+        auto first = std::min_element(jobs.begin(), jobs.end(), [](const Job &a, const Job &b){ return a.priority < b.priority; });
+        Job job = *first;
+        *first = jobs.back();
+        jobs.pop_back();
+        return job;
+    }
+
+    void load(){ // Loop of each I/O thread
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true){
+            io_condition.wait(lock, [&]{ return stopping || !io_jobs.empty(); });
+            if (stopping) return;
+            Job job = take_first(io_jobs);
+            num_working++;
+            lock.unlock(); // Read without blocking the main thread
+
+            Chunk_column column;
+            bool saved = cache->take(job.chunk_x, job.chunk_z, column) || world_save->load_column(job.chunk_x, job.chunk_z, column);
+
+            lock.lock();
+            num_working--;
+            if (saved) finished.push_back(std::move(column));
+            else{
+                generation_jobs.push_back(job);
+                generation_condition.notify_one();
+            }
+        }
+    }
+
+    void generate(){ // Loop of each generation thread
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true){
+            generation_condition.wait(lock, [&]{ return stopping || !generation_jobs.empty(); });
+            if (stopping) return;
+            Job job = take_first(generation_jobs);
+            num_working++;
+            lock.unlock(); // Generate without blocking the main thread
+
+            Chunk_column column = {job.chunk_x, job.chunk_z, generator.generate_column(job.chunk_x, job.chunk_z)};
+
+            lock.lock();
+            finished.push_back(std::move(column));
+            num_working--;
+        }
+    }
+};
+#endif
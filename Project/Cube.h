@@ -9,13 +9,11 @@
 #include <vector>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
-#include "Mirror.h"
 
 class Cube{
 public:
     int x, y, z; // Coordinates of cube
-    int texture_ID; // Texture to use for the block
-    std::vector<Mirror> mirrors; // List of mirrors attached to this block (so that when the block is destroyed the mirrors are as well)
+    uint8_t block; // Block ID of the type of the cube (see Block_registry)
 
     static inline std::vector<float> vertices = {
             // First 3 are 3D positions, next 2 are texture positions, final 3 are normal vector components
@@ -66,31 +64,12 @@ public:
             21, 22, 23
     };
 
-    Cube(int x, int y, int z, int texture_ID){ // Constructor of Cube takes its coordinates as input
+    Cube(int x, int y, int z, uint8_t block){ // Constructor of Cube takes its coordinates as input
         this->x = x;
         this->y = y;
         this->z = z;
 
-        this->texture_ID = texture_ID;
-    }
-
-    void destroy_mirrors_cube(){
-        // Destruct the textures linked to the mirrors attached to this cube, to avoid spending time computing views for mirrors that don't exist anymore
-        for (Mirror mirror: mirrors){
-            for (int i = 0; i < Texture::textures.size(); i++) {
-                if (Texture::textures[i].texture_ID == mirror.texture.texture_ID) {
-                    for (int j = 0; j < Mirror::mirrors.size(); j++) {
-                        if (mirror.texture.texture_ID == Mirror::mirrors[j].texture.texture_ID) {
-                            Mirror::mirrors.erase(Mirror::mirrors.begin() + j);
-
-                            j--; // After removing a mirror they are all shifted one position before, so we decrement j to avoid missing one
-                        }
-                    }
-                    Texture::textures.erase(Texture::textures.begin() + i);
-                    i--;
-                }
-            }
-        }
+        this->block = block;
     }
 
     bool part(glm::vec3 pos){ // Checks if position "pos" is inside the cube, meaning it's less than half a cube away from the center of the cube
@@ -67,10 +67,9 @@ public:
                 return;
             }
 
-            unsigned int VBO_instanced;
-            glGenBuffers(1, &VBO_instanced);
+            if (VBO_instanced == 0) glGenBuffers(1, &VBO_instanced); // Created once and re-filled at each call
             glBindBuffer(GL_ARRAY_BUFFER, VBO_instanced);
-            glBufferData(GL_ARRAY_BUFFER, translations.size() * sizeof(glm::vec3), &translations[0], GL_STATIC_DRAW);
+            glBufferData(GL_ARRAY_BUFFER, translations.size() * sizeof(glm::vec3), &translations[0], GL_STREAM_DRAW);
 
             glEnableVertexAttribArray(position_attributes.size()); // Add a new attribute (after positions, texture, and normals in the case of cubes)
             glVertexAttribPointer(position_attributes.size(), 3, GL_FLOAT, GL_FALSE, 3*sizeof(float), (void *) 0); // The new attribute is a vec3, so size is 3
@@ -102,8 +101,32 @@ public:
         }
     }
 
+    void draw_instanced(unsigned int instance_VBO, int num_instances, glm::mat4 view, glm::mat4 projection, Shader shader, int texture, int num_vertices, int type_primitive) {
+        // Draw num_instances objects whose translations are already on the GPU in instance_VBO, so nothing is uploaded
+        if (num_instances == 0) return; // Nothing to draw
+        shader.use();
+
+        glBindVertexArray(VAO);
+        if (texture >= 0) glBindTexture(GL_TEXTURE_2D, texture); // Bound to texture unit 0 by default
+
+        shader.set_uniform("view", view);
+        shader.set_uniform("projection", projection);
+        shader.set_uniform("model", glm::mat4(1.0f)); // No translation in model so that the shader uses the instance translations
+
+        glBindBuffer(GL_ARRAY_BUFFER, instance_VBO);
+        glEnableVertexAttribArray(position_attributes.size()); // Add a new attribute (after positions, texture, and normals in the case of cubes)
+        glVertexAttribPointer(position_attributes.size(), 3, GL_FLOAT, GL_FALSE, 3*sizeof(float), (void *) 0); // The new attribute is a vec3, so size is 3
+        glVertexAttribDivisor(position_attributes.size(), 1);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        if (use_EBO) glDrawElementsInstanced(type_primitive, num_vertices, GL_UNSIGNED_INT, 0, num_instances);
+        else glDrawArraysInstanced(type_primitive, 0, num_vertices, num_instances);
+        glBindVertexArray(0);
+    }
+
 private:
     unsigned int VAO; // VAO used to draw the object
+    unsigned int VBO_instanced = 0; // VBO holding the translations of instanced draws, created on first use
     std::vector<float> vertices; // List of vertices
     bool use_EBO; // True if we use an EBO to select vertices in order
     std::vector<unsigned int> vertices_indices; // List of vertices indices (empty if use_EBO is false)
@@ -0,0 +1,99 @@
+#ifndef EDIT_HISTORY_H
+#define EDIT_HISTORY_H
+
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <cstdint>
+
+struct Block_delta{ // Change of one block, 16 bytes
+    int x, y, z;
+    uint8_t old_block, new_block;
+};
+
+class Edit_history{ // Undo and redo of block edits. Only the changed blocks are recorded, grouped in transactions that are undone and redone as a whole
+    // Memory is proportional to the number of recorded edits, the oldest transactions being forgotten above max_edits
+public:
+    Edit_history(size_t max_edits){
+        this->max_edits = max_edits;
+    }
+
+    void begin_transaction(){ // Edits recorded until the matching end_transaction are undone together. Transactions can be nested, only the outermost one counts
+        if (depth++ > 0) return;
+        open_size = 0;
+    }
+
+    void end_transaction(){
+        if (--depth > 0) return;
+        if (open_size == 0) return; // Nothing changed, and the undone transactions can still be redone
+        transaction_sizes.push_back(open_size);
+        num_done++;
+        while (deltas.size() > max_edits && num_done > 1){ // Forget the oldest transactions, but never the last one
+            deltas.erase(deltas.begin(), deltas.begin() + transaction_sizes.front());
+            num_done_deltas -= transaction_sizes.front();
+            transaction_sizes.pop_front();
+            num_done--;
+        }
+    }
+
+    void record(int x, int y, int z, uint8_t old_block, uint8_t new_block){ // Records an edit, in its own transaction if none is open
+        if (old_block == new_block) return;
+        if (depth == 0){
+            begin_transaction();
+            record(x, y, z, old_block, new_block);
+            end_transaction();
+            return;
+        }
+        if (open_size == 0) forget_undone(); // Redoing is not possible anymore after a new edit
+        deltas.push_back({x, y, z, old_block, new_block});
+        open_size++;
+        num_done_deltas++;
+    }
+
+    bool undo(std::vector<Block_delta> &changes){ // Fills changes with the edits that undo the last transaction, in the order they should be applied. Returns false if there is nothing to undo
+        changes.clear();
+        if (depth > 0 || num_done == 0) return false;
+        num_done--;
+        size_t size = transaction_sizes[num_done];
+        changes.reserve(size);
+        for (size_t i = 0; i < size; i++){ // Last edit first, so that a block edited several times gets back its first old block
+            const Block_delta &delta = deltas[num_done_deltas - 1 - i];
+            changes.push_back({delta.x, delta.y, delta.z, delta.new_block, delta.old_block});
+        }
+        num_done_deltas -= size;
+        return true;
+    }
+
+    bool redo(std::vector<Block_delta> &changes){ // Same for the last undone transaction
+        changes.clear();
+        if (depth > 0 || num_done == transaction_sizes.size()) return false;
+        size_t size = transaction_sizes[num_done];
+        changes.assign(deltas.begin() + num_done_deltas, deltas.begin() + num_done_deltas + size);
+        num_done_deltas += size;
+        num_done++;
+        return true;
+    }
+
+    size_t num_edits() const {
+        return deltas.size();
+    }
+
+    size_t memory_bytes() const { // Approximately, deques allocating in blocks
+        return sizeof(Edit_history) + deltas.size()*sizeof(Block_delta) + transaction_sizes.size()*sizeof(size_t);
+    }
+
+private:
+    size_t max_edits;
+    std::deque<Block_delta> deltas; // Edits of all transactions in order, the ones of the undone transactions at the end
+    std::deque<size_t> transaction_sizes; // Number of edits of each closed transaction
+    size_t open_size = 0; // Number of edits of the open transaction, after the ones of the closed transactions in deltas
+    size_t num_done = 0; // Transactions that are not undone
+    size_t num_done_deltas = 0; // Edits of these transactions
+    int depth = 0; // Number of open transactions
+
+    void forget_undone(){
+        deltas.erase(deltas.begin() + num_done_deltas, deltas.end());
+        transaction_sizes.erase(transaction_sizes.begin() + num_done, transaction_sizes.end());
+    }
+};
+#endif
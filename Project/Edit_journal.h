@@ -0,0 +1,276 @@
+#ifndef EDIT_JOURNAL_H
+#define EDIT_JOURNAL_H
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstdio>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <random>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+struct Block_edit{
+    int x, y, z;
+    uint8_t block; // New block ID
+};
+
+class Edit_journal{ // Append-only file of block edits, written by a background thread that syncs them to disk in batches every sync_interval
+    // so that a crash loses at most the edits of the last sync_interval, without the render loop ever waiting for the disk
+    // File layout: batches of (number of edits, edits of 13 bytes, checksum), a batch cut by a crash being detected by its size or checksum
+public:
+    long long edits_written = 0; // Statistics since the journal was opened
+    int num_syncs = 0;
+    double sync_time = 0.0; // Total time spent writing and syncing, in s
+
+    Edit_journal(std::string path, double sync_interval){
+        this->path = path;
+        this->sync_interval = sync_interval;
+        num_appended = read_all().size(); // Edits already in the file are numbered first
+        file = std::fopen(path.c_str(), "ab");
+        if (file == nullptr) std::cout << "Could not open edit journal " << path << ", edits are not journaled" << std::endl;
+        writer = std::thread(&Edit_journal::write_loop, this);
+    }
+
+    Edit_journal(const Edit_journal&) = delete; // Owns the file and the thread
+    Edit_journal& operator=(const Edit_journal&) = delete;
+
+    ~Edit_journal(){
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        condition.notify_all();
+        writer.join(); // Writes the last edits
+        if (file != nullptr) std::fclose(file);
+    }
+
+    void append(int x, int y, int z, uint8_t block){ // Queues an edit, it is on disk at most sync_interval later
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.push_back({x, y, z, block});
+        num_appended++;
+    }
+
+    void append_all(const std::vector<Block_edit> &edits){ // Same as append for each edit, locking once
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.insert(pending.end(), edits.begin(), edits.end());
+        num_appended += edits.size();
+    }
+
+    long long position(){ // Number of edits appended so far, marks the edits included in a snapshot of the world (see discard_before)
+        std::lock_guard<std::mutex> lock(mutex);
+        return num_appended;
+    }
+
+    void sync(){ // Writes the queued edits now and waits for them to be on disk
+        write_pending();
+    }
+
+    void clear(){ // Empties the journal, once all its edits are saved in the region files (the queued edits as well)
+        std::lock_guard<std::mutex> file_lock(file_mutex);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.clear();
+            first_in_file = num_appended;
+        }
+        if (file != nullptr) std::fclose(file);
+        file = std::fopen(path.c_str(), "wb");
+        flush_to_disk();
+    }
+
+    void discard_before(long long position){ // Removes the edits made before position, once a snapshot taken at that position is saved in the region files
+        // The edits made since then are kept: the file is rewritten with only them, then replaces the old one
+        std::lock_guard<std::mutex> file_lock(file_mutex);
+        if (position <= first_in_file) return;
+        write_pending_locked();
+        std::vector<Block_edit> edits = read_file();
+        size_t num_discarded = std::min((size_t)(position - first_in_file), edits.size());
+        std::vector<Block_edit> kept(edits.begin() + num_discarded, edits.end());
+
+        std::string temporary_path = path + ".tmp";
+        FILE* output = std::fopen(temporary_path.c_str(), "wb");
+        if (output == nullptr) return; // The old edits are replayed again at startup, which is harmless
+        if (!kept.empty()){
+            std::vector<uint8_t> batch = make_batch(kept);
+            std::fwrite(batch.data(), 1, batch.size(), output);
+        }
+        std::fflush(output);
+#ifdef _WIN32
+        _commit(_fileno(output));
+#else
+        fsync(fileno(output));
+#endif
+        std::fclose(output);
+        if (file != nullptr) std::fclose(file);
+#ifdef _WIN32
+        std::remove(path.c_str()); // rename doesn't replace existing files on Windows
+#endif
+        std::rename(temporary_path.c_str(), path.c_str());
+        file = std::fopen(path.c_str(), "ab");
+        first_in_file += num_discarded;
+    }
+
+    std::vector<Block_edit> read_all(){ // Edits of the journal in the order they were made, stopping at the first incomplete batch
+        std::lock_guard<std::mutex> file_lock(file_mutex);
+        return read_file();
+    }
+
+    static void benchmark(std::string path){ // Prints the number of edits per second the journal sustains, with batched syncs and with one sync per edit
+        std::remove(path.c_str());
+        std::mt19937 random(0);
+        double duration = 2.0;
+        {
+            Edit_journal journal(path, 0.005);
+            auto start = std::chrono::steady_clock::now();
+            long long num_edits = 0;
+            while (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() < duration){
+                for (int i = 0; i < 1000; i++) journal.append(random() % 1024, random() % 64, random() % 1024, random() % 8);
+                num_edits += 1000;
+            }
+            journal.sync();
+            double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::cout << "Journal with syncs every 5 ms: " << (long long)(num_edits/time) << " edits per second, " << journal.num_syncs << " syncs of "
+                      << 1000*journal.sync_time/std::max(1, journal.num_syncs) << " ms on average" << std::endl;
+
+            auto replay_start = std::chrono::steady_clock::now();
+            long long num_replayed = journal.read_all().size();
+            double replay_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - replay_start).count();
+            std::cout << "Replay: " << num_replayed << " edits read in " << 1000*replay_time << " ms" << std::endl;
+        }
+        std::remove(path.c_str());
+        {
+            Edit_journal journal(path, 0.005);
+            int num_edits = 200;
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < num_edits; i++){
+                journal.append(random() % 1024, random() % 64, random() % 1024, random() % 8);
+                journal.sync();
+            }
+            double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::cout << "Journal with one sync per edit: " << (long long)(num_edits/time) << " edits per second" << std::endl;
+        }
+        std::remove(path.c_str());
+    }
+
+private:
+    static inline const int edit_bytes = 13;
+
+    std::string path;
+    double sync_interval; // In s
+    FILE* file; // Opened in append mode
+    std::thread writer;
+    std::mutex file_mutex; // Protects the file and the statistics, and is held from taking the pending edits to syncing them so that batches are written in order
+    std::mutex mutex; // Protects pending and stopping, and is never held while writing so that append never waits for the disk
+    std::condition_variable condition;
+    std::vector<Block_edit> pending; // Edits not written yet
+    long long num_appended = 0; // Protected by mutex
+    long long first_in_file = 0; // Number of the first edit of the file, the previous ones being discarded. Protected by file_mutex, and by mutex in clear
+    bool stopping = false;
+
+    void write_loop(){
+        while (true){
+            bool stop;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                condition.wait_for(lock, std::chrono::duration<double>(sync_interval), [&]{ return stopping; });
+                stop = stopping;
+            }
+            write_pending();
+            if (stop) return;
+        }
+    }
+
+    void write_pending(){ // Writes the pending edits as one batch and syncs the file
+        std::lock_guard<std::mutex> file_lock(file_mutex);
+        write_pending_locked();
+    }
+
+    void write_pending_locked(){ // Same with file_mutex already held
+        std::vector<Block_edit> edits;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            edits.swap(pending);
+        }
+        if (edits.empty() || file == nullptr) return;
+        auto start = std::chrono::steady_clock::now();
+        std::vector<uint8_t> batch = make_batch(edits);
+        std::fwrite(batch.data(), 1, batch.size(), file);
+        flush_to_disk();
+        edits_written += edits.size();
+        num_syncs++;
+        sync_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    std::vector<Block_edit> read_file(){
+        std::vector<Block_edit> edits;
+        FILE* input = std::fopen(path.c_str(), "rb");
+        if (input == nullptr) return edits;
+        std::vector<uint8_t> bytes;
+        uint8_t buffer[4096];
+        size_t num_read;
+        while ((num_read = std::fread(buffer, 1, sizeof(buffer), input)) > 0) bytes.insert(bytes.end(), buffer, buffer + num_read);
+        std::fclose(input);
+
+        size_t position = 0;
+        while (position + 4 <= bytes.size()){
+            uint32_t num_edits = read_uint32(&bytes[position]);
+            size_t batch_bytes = 4 + (size_t)num_edits*edit_bytes + 4;
+            if (num_edits == 0 || position + batch_bytes > bytes.size()) break; // Cut by a crash
+            const uint8_t* data = &bytes[position + 4];
+            if (checksum(data, num_edits*edit_bytes) != read_uint32(data + num_edits*edit_bytes)) break;
+            for (uint32_t i = 0; i < num_edits; i++){
+                const uint8_t* edit = data + i*edit_bytes;
+                edits.push_back({(int)read_uint32(edit), (int)read_uint32(edit + 4), (int)read_uint32(edit + 8), edit[12]});
+            }
+            position += batch_bytes;
+        }
+        if (position != bytes.size()) std::cout << "Edit journal: ignored " << bytes.size() - position << " bytes of an incomplete batch" << std::endl;
+        return edits;
+    }
+
+    static std::vector<uint8_t> make_batch(const std::vector<Block_edit> &edits){
+        std::vector<uint8_t> batch;
+        batch.reserve(8 + edits.size()*edit_bytes);
+        append_uint32(batch, edits.size());
+        for (Block_edit edit: edits){
+            append_uint32(batch, edit.x);
+            append_uint32(batch, edit.y);
+            append_uint32(batch, edit.z);
+            batch.push_back(edit.block);
+        }
+        append_uint32(batch, checksum(&batch[4], edits.size()*edit_bytes));
+        return batch;
+    }
+
+    void flush_to_disk(){
+        if (file == nullptr) return;
+        std::fflush(file);
+#ifdef _WIN32
+        _commit(_fileno(file));
+#else
+        fsync(fileno(file));
+#endif
+    }
+
+    static uint32_t checksum(const uint8_t* data, size_t num_bytes){ // FNV-1a
+        uint32_t hash = 2166136261u;
+        for (size_t i = 0; i < num_bytes; i++) hash = (hash ^ data[i]) * 16777619u;
+        return hash;
+    }
+
+    static void append_uint32(std::vector<uint8_t> &bytes, uint32_t value){ // Little-endian
+        for (int i = 0; i < 4; i++) bytes.push_back((value >> (8*i)) & 0xFF);
+    }
+
+    static uint32_t read_uint32(const uint8_t* bytes){
+        return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+    }
+};
+#endif
@@ -0,0 +1,99 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <iostream>
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define FRUSTUM_SSE
+#include <xmmintrin.h>
+#endif
+
+class Frustum{ // The 6 planes of the volume seen through a view and projection matrix, to skip the boxes that are outside of it
+    // A plane (a, b, c, d) keeps the points with a*x + b*y + c*z + d >= 0. The planes are not normalized, only the sign of this value is used
+public:
+    Frustum(glm::mat4 view_projection){ // Planes extracted from the rows of projection*view (clip coordinates between -w and w)
+        glm::vec4 rows[4];
+        for (int i = 0; i < 4; i++) rows[i] = glm::vec4(view_projection[0][i], view_projection[1][i], view_projection[2][i], view_projection[3][i]);
+        for (int i = 0; i < 3; i++){
+            planes[2*i] = rows[3] + rows[i]; // Left, bottom, near
+            planes[2*i + 1] = rows[3] - rows[i]; // Right, top, far
+        }
+    }
+
+    bool intersects(glm::vec3 center, float half_size) const { // Whether the cube of the given center and half size is at least partly inside. Cubes close to a corner of the frustum may be kept while being outside
+        for (const glm::vec4 &plane: planes){
+            float radius = (std::abs(plane.x) + std::abs(plane.y) + std::abs(plane.z))*half_size; // Projection of the cube on the normal of the plane
+            if ((plane.x*center.x + plane.y*center.y) + (plane.z*center.z + (plane.w + radius)) < 0) return false; // Same order of operations as in cull
+        }
+        return true;
+    }
+
+    void cull(const float* center_x, const float* center_y, const float* center_z, int num_cubes, float half_size, uint8_t* visible) const {
+        // Sets visible[i] to intersects(center i, half_size) for each cube, testing 4 cubes at once with SSE. Centers are given as one array per coordinate
+        int i = 0;
+#ifdef FRUSTUM_SSE
+        __m128 a[6], b[6], c[6], d[6]; // Plane coefficients broadcast to the 4 lanes, the radius being added to d since all cubes have the same size
+        for (int p = 0; p < 6; p++){
+            a[p] = _mm_set1_ps(planes[p].x);
+            b[p] = _mm_set1_ps(planes[p].y);
+            c[p] = _mm_set1_ps(planes[p].z);
+            d[p] = _mm_set1_ps(planes[p].w + (std::abs(planes[p].x) + std::abs(planes[p].y) + std::abs(planes[p].z))*half_size);
+        }
+        const __m128 zero = _mm_setzero_ps();
+        for (; i + 4 <= num_cubes; i += 4){
+            __m128 x = _mm_loadu_ps(center_x + i), y = _mm_loadu_ps(center_y + i), z = _mm_loadu_ps(center_z + i);
+            __m128 inside = _mm_cmpge_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(a[0], x), _mm_mul_ps(b[0], y)), _mm_add_ps(_mm_mul_ps(c[0], z), d[0])), zero);
+            for (int p = 1; p < 6; p++){
+                __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(a[p], x), _mm_mul_ps(b[p], y)), _mm_add_ps(_mm_mul_ps(c[p], z), d[p]));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, zero));
+            }
+            int mask = _mm_movemask_ps(inside);
+            for (int lane = 0; lane < 4; lane++) visible[i + lane] = (mask >> lane) & 1;
+        }
+#endif
+        for (; i < num_cubes; i++) visible[i] = intersects(glm::vec3(center_x[i], center_y[i], center_z[i]), half_size);
+    }
+
+    static void benchmark(){ // Prints the number of cubes tested per second by cull and by intersects (checked to agree by the tests)
+        const int num_cubes = 4096, num_repeats = 2000;
+        std::mt19937 random(0);
+        std::uniform_real_distribution<float> coordinate(-200.0f, 200.0f);
+        std::vector<float> center_x(num_cubes), center_y(num_cubes), center_z(num_cubes);
+        for (int i = 0; i < num_cubes; i++){
+            center_x[i] = coordinate(random);
+            center_y[i] = coordinate(random)/4;
+            center_z[i] = coordinate(random);
+        }
+        Frustum frustum(glm::perspective(glm::radians(45.0f), 16.0f/9.0f, 0.1f, 100.0f) * glm::lookAt(glm::vec3(0.0f, 10.0f, 0.0f), glm::vec3(1.0f, 9.0f, 0.5f), glm::vec3(0.0f, 1.0f, 0.0f)));
+
+        std::vector<uint8_t> visible(num_cubes), expected(num_cubes);
+        auto start = std::chrono::steady_clock::now();
+        for (int repeat = 0; repeat < num_repeats; repeat++) frustum.cull(&center_x[0], &center_y[0], &center_z[0], num_cubes, 8.0f, &visible[0]);
+        double cull_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        start = std::chrono::steady_clock::now();
+        for (int repeat = 0; repeat < num_repeats; repeat++){
+            for (int i = 0; i < num_cubes; i++) expected[i] = frustum.intersects(glm::vec3(center_x[i], center_y[i], center_z[i]), 8.0f);
+        }
+        double scalar_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        int num_visible = 0;
+        for (int i = 0; i < num_cubes; i++) num_visible += visible[i];
+#ifdef FRUSTUM_SSE
+        std::string kernel = "SSE, 4 cubes at once";
+#else
+        std::string kernel = "no SSE on this target";
+#endif
+        std::cout << "Frustum culling (" << kernel << "): " << (long long)(num_cubes*(double)num_repeats/cull_time/1e6) << " M cubes per second, one cube at a time: "
+                  << (long long)(num_cubes*(double)num_repeats/scalar_time/1e6) << " M cubes per second. " << num_visible << " of " << num_cubes << " cubes visible" << std::endl;
+    }
+
+private:
+    glm::vec4 planes[6];
+};
+#endif
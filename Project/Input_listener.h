@@ -41,6 +41,11 @@ public:
          if (glfwGetKey(window, GLFW_KEY_SPACE) == GLFW_PRESS) directions.push_back("up");
          if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS) directions.push_back("down");
          if (glfwGetKey(window, GLFW_KEY_ENTER) == GLFW_PRESS) directions.push_back("weather"); // Toogle the current weather
+         if (glfwGetKey(window, GLFW_KEY_M) == GLFW_PRESS) directions.push_back("meshing"); // Toggle between greedy meshing and instanced cubes
+         if (glfwGetKey(window, GLFW_KEY_U) == GLFW_PRESS) directions.push_back("undo"); // Undo the last edit
+         if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS) directions.push_back("redo"); // Redo the last undone edit
+         if (glfwGetKey(window, GLFW_KEY_X) == GLFW_PRESS) directions.push_back("explode"); // Remove a sphere of blocks around the block in the middle of the screen
+         if (glfwGetKey(window, GLFW_KEY_V) == GLFW_PRESS) directions.push_back("view distance"); // Cycle through the view distances
 
          return directions;
      }
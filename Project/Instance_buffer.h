@@ -0,0 +1,108 @@
+#ifndef INSTANCE_BUFFER_H
+#define INSTANCE_BUFFER_H
+
+#include <iostream>
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+
+class Instance_buffer{ // GPU-resident list of block translations, patched in place when blocks are added or removed
+public:
+    static inline long long bytes_uploaded = 0; // Total number of bytes sent to the GPU by all instance buffers, to check that nothing is uploaded when nothing changes
+
+    unsigned int VBO = 0; // Buffer holding the translations on the GPU, created on first upload
+    std::vector<glm::vec3> translations; // Copy of the translations on the CPU, in the same order as on the GPU
+
+    int size(){
+        return translations.size();
+    }
+
+    void add(int64_t key, glm::vec3 translation){ // Key identifies the block (see World::block_key), to find it back when removing it
+        append(key, translation);
+        if (translations.size() > capacity) upload_all(); // The buffer needs to grow, so send everything again
+        else upload(translations.size()-1, 1);
+    }
+
+    void add_all(const std::vector<std::pair<int64_t, glm::vec3>> &blocks){ // Same as add for many blocks, sent to the GPU at once
+        int first = translations.size();
+        for (const std::pair<int64_t, glm::vec3> &block: blocks) append(block.first, block.second);
+        if (translations.size() > capacity) upload_all();
+        else upload(first, translations.size() - first);
+    }
+
+    void append(int64_t key, glm::vec3 translation){ // Same as add but only on the CPU, upload_all must be called afterwards
+        index_of_key[key] = translations.size();
+        keys.push_back(key);
+        translations.push_back(translation);
+    }
+
+    void remove(int64_t key){ // Swap-remove: the last translation takes the place of the removed one
+        auto it = index_of_key.find(key);
+        if (it == index_of_key.end()) return;
+        int index = it->second;
+        int last = translations.size()-1;
+        index_of_key.erase(it);
+        if (index != last){
+            translations[index] = translations[last];
+            keys[index] = keys[last];
+            index_of_key[keys[index]] = index;
+            upload(index, 1);
+        }
+        translations.pop_back();
+        keys.pop_back();
+    }
+
+    void remove_all(const std::vector<int64_t> &keys_to_remove){ // Same as remove for many blocks, the moved translations being sent to the GPU at once
+        int first_moved = translations.size();
+        for (int64_t key: keys_to_remove){
+            auto it = index_of_key.find(key);
+            if (it == index_of_key.end()) continue;
+            int index = it->second;
+            int last = translations.size()-1;
+            index_of_key.erase(it);
+            if (index != last){
+                translations[index] = translations[last];
+                keys[index] = keys[last];
+                index_of_key[keys[index]] = index;
+                first_moved = std::min(first_moved, index);
+            }
+            translations.pop_back();
+            keys.pop_back();
+        }
+        if (first_moved < translations.size()) upload(first_moved, translations.size() - first_moved);
+    }
+
+    void clear(){
+        translations.clear();
+        keys.clear();
+        index_of_key.clear();
+    }
+
+    void upload_all(){ // Re-allocates the GPU buffer with some margin and sends all translations
+        if (VBO == 0) glGenBuffers(1, &VBO);
+        capacity = std::max(64, (int)translations.size()*2);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(glm::vec3), NULL, GL_DYNAMIC_DRAW);
+        if (!translations.empty()) glBufferSubData(GL_ARRAY_BUFFER, 0, translations.size() * sizeof(glm::vec3), &translations[0]);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        bytes_uploaded += translations.size() * sizeof(glm::vec3);
+    }
+
+private:
+    int capacity = 0; // Number of translations the GPU buffer can hold
+    std::vector<int64_t> keys; // Key of the block at each index of translations
+    std::unordered_map<int64_t, int> index_of_key; // Index in translations of each block key
+
+    void upload(int index, int count){ // Sends count translations starting at this index to the GPU
+        if (count == 0) return;
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferSubData(GL_ARRAY_BUFFER, index * sizeof(glm::vec3), count * sizeof(glm::vec3), &translations[index]);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        bytes_uploaded += count * sizeof(glm::vec3);
+    }
+};
+#endif
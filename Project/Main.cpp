@@ -22,20 +22,43 @@
 #include "Shadow.h"
 #include "Particles.h"
 #include "NPC.h"
+#include "Noise.h"
+#include "World_save.h"
+#include "Edit_journal.h"
 
 #define PATH "../../Project/" // Path to go from where the program is run to current folder
 #define MOUSE_SENSITIVITY 0.05 // Sensitivity of yaw and pitch wrt mouse movements
 #define MAX_DISTANCE_REMOVE 15 // We only remove clicked blocks up to this distance
-#define NUM_CUBES_SIDE 100 // We create a NUM_CUBES_SIDE x NUM_CUBES_SIDE area of cubes
+#define TERRAIN_SEED 502 // Seed of the terrain generator, the same seed always gives the same terrain
+#define STREAMING_RADIUS 20 // Chunk columns are loaded in a disc of STREAMING_RADIUS chunks around the camera, and unloaded a chunk further. Beyond 4*LOD_DISTANCE so that all the levels of detail are used
+#define STREAMING_THREADS 2 // Number of threads generating the chunk columns
+#define STREAMING_IO_THREADS 1 // Number of threads loading the saved chunk columns from the region files
+#define MEMORY_BUDGET (64 << 20) // Bytes of world data kept in memory: loaded chunks, and unloaded ones compressed until the budget is reached
+#define PREFETCH_TIME 2.0 // Chunk columns are prefetched around where the camera will be in PREFETCH_TIME s at its current velocity
+#define STREAMING_COLUMNS_PER_FRAME 4 // Maximum number of generated chunk columns inserted in the map per frame
+#define SAVE_DIRECTORY "save/" // Directory of the region files of the world, relative to where the program is run
+#define JOURNAL_SYNC_INTERVAL 0.005 // Edits are written to the journal on disk in batches every JOURNAL_SYNC_INTERVAL s, so at most this much is lost in a crash
 #define DAY_DURATION 200000 // Nb of milliseconds in an in-game day
 #define NEAR 0.1f
-#define FAR 100.0f // Near and far values used for perspective projection
+#define FAR(streaming_radius) ((streaming_radius + 1)*16.0f) // Near and far values used for perspective projection, far enough to see all the chunks loaded with this streaming radius
 #define CAMERA_SPEED 6.0f // Speed of movement of camera
 #define MIRROR_RESOL 1000 // Resolution of mirrors
 #define SHADOW_DEPTH_SIZE 8192 // Size of the depth map frame (larger means more rays). NOTE: if shadows look incorrect, try to reduce this number
 #define SPEED_RAINFALL 3 // Speed of fall of the rain drops
 #define AREA_RAIN_DROPS 15 // Rain appears in a AREA_RAIN_DROPS x AREA_RAIN_DROPS zone around the camera
 #define NUMBER_RAIN_DROPS 8000 // Number of rain drops in the defined area
+#define GREEDY_MESHING true // Whether blocks are drawn as merged meshes per chunk (true) or as instanced cubes (false), toggled with key M
+#define OCCUPANCY_TREE false // Whether the world keeps a sparse tree of its empty and full regions, used to accelerate raycasts. Off by default: it is updated block by block, which slows down streaming and bulk edits
+#define VIEW_DISTANCE_RADII {6, 12, STREAMING_RADIUS} // Streaming radii cycled through with key V, to compare the frame times at several view distances
+#define LOD_DISTANCE 4 // Chunk columns LOD_DISTANCE chunks away from the camera are meshed at half resolution, twice as far at a quarter and 4 times as far at an eighth (0 to disable)
+#define RENDER_QUEUE true // Whether the faces of the chunks are sorted by program, texture and depth before being drawn, to bind each texture fewer times
+#define CONNECTIVITY_CULLING true // Whether the chunks that can't be seen from the camera through non-opaque blocks (caves, underground) are skipped
+#define OCCLUSION_CULLING true // Whether the chunks hidden behind the chunks close to the camera are skipped, using a small depth buffer drawn on the CPU
+#define REMESH_TIME_BUDGET 0.004 // Time in s that can be spent per frame to remesh the chunks changed by edits
+#define EXPLOSION_RADIUS 12 // Radius in blocks of the sphere removed by an explosion (key X)
+#define HISTORY_MAX_EDITS (1 << 22) // Number of block edits that can be undone (16 bytes each)
+#define BENCHMARK_FRAMES 200 // Average frame time and number of triangles are printed every BENCHMARK_FRAMES frames
+#define AUTOSAVE_INTERVAL 60.0 // Time in s between two saves of the modified chunk columns, written by a background thread
 
 int width = 1600, height = 1000; // Size of screen
 std::vector<std::string> files_textures = {"grass.png", "dirt.png", "gold.png", "spruce.png", "bookshelf.png", "leaf.png", "glass.png"};
@@ -45,6 +68,21 @@ float delta_time = 0.0f; // Time between 2 last frames
 std::string path_string = PATH;
 bool SUNNY = true; // Whether we want the weather to be sunny (sun and shadows) or rainy
 float time_last_toggle_weather = 0.0f; // We can only press the weather toggle once per second to avoid toggling twice if pressing for too long
+float time_last_toggle_meshing = 0.0f; // Same for the meshing mode toggle
+float time_last_undo = 0.0f; // Same for undo and redo
+float time_last_explosion = 0.0f; // Same for explosions
+float time_last_view_distance = 0.0f; // Same for the view distance
+int view_distance_index = -1; // Index in VIEW_DISTANCE_RADII of the current streaming radius, -1 for STREAMING_RADIUS at startup
+double benchmark_time = 0.0; // Sum of the frame times since the last benchmark print
+int benchmark_frames = 0; // Number of frames since the last benchmark print
+double time_last_autosave = 0.0;
+bool autosave_running = false; // Whether the last autosave is still being written, in which case the frame times are measured to see its impact
+int autosave_frames = 0;
+double autosave_frame_time_sum = 0.0, autosave_frame_time_max = 0.0;
+
+bool opaque_texture(std::string file){ // Whether the block type of this texture is completely opaque. Only non-opaque textures are leaves and glass
+    return !(file == "leaf.png" || file == "glass.png");
+}
 
 double fps(){
     // Calculates and prints FPS
@@ -65,6 +103,54 @@ void check_for_input(GLFWwindow* window, Camera* camera, Map* map){
             time_last_toggle_weather = glfwGetTime();
         }
     }
+    for (int i = 0; i < directions.size(); i++) if (directions[i] == "meshing"){
+        directions.erase(directions.begin() + i);
+        i--;
+        if (glfwGetTime() - time_last_toggle_meshing > 1.0f){
+            map->greedy_meshing = !map->greedy_meshing;
+            time_last_toggle_meshing = glfwGetTime();
+            map->triangles_drawn = 0; // Restart the benchmark with the new mode
+            benchmark_time = 0.0;
+            benchmark_frames = 0;
+        }
+    }
+    for (int i = 0; i < directions.size(); i++) if (directions[i] == "view distance"){
+        directions.erase(directions.begin() + i);
+        i--;
+        if (glfwGetTime() - time_last_view_distance > 1.0f){
+            time_last_view_distance = glfwGetTime();
+            std::vector<int> radii = VIEW_DISTANCE_RADII;
+            view_distance_index = (view_distance_index + 1) % radii.size();
+            map->set_streaming_radius(radii[view_distance_index]);
+            Window::far = FAR(radii[view_distance_index]);
+            benchmark_time = 0.0; // Restart the benchmark with the new view distance
+            benchmark_frames = 0;
+        }
+    }
+    for (int i = 0; i < directions.size(); i++) if (directions[i] == "undo" || directions[i] == "redo"){
+        bool undo = directions[i] == "undo";
+        directions.erase(directions.begin() + i);
+        i--;
+        if (glfwGetTime() - time_last_undo > 0.3f){
+            time_last_undo = glfwGetTime();
+            double start = glfwGetTime();
+            int num_blocks = undo ? map->undo() : map->redo();
+            if (num_blocks > 0) std::cout << (undo ? "Undid " : "Redid ") << num_blocks << " block edits in " << 1000*(glfwGetTime() - start) << " ms" << std::endl;
+        }
+    }
+    for (int i = 0; i < directions.size(); i++) if (directions[i] == "explode"){
+        directions.erase(directions.begin() + i);
+        i--;
+        if (glfwGetTime() - time_last_explosion > 0.5f){
+            time_last_explosion = glfwGetTime();
+            Raycast_hit hit = map->world.raycast(camera->camera_pos, camera->camera_front, MAX_DISTANCE_REMOVE);
+            if (hit.hit){
+                double start = glfwGetTime();
+                int num_blocks = map->explode(hit.block, EXPLOSION_RADIUS);
+                std::cout << "Explosion removed " << num_blocks << " blocks in " << 1000*(glfwGetTime() - start) << " ms" << std::endl;
+            }
+        }
+    }
     for (int i = 0; i < directions.size(); i++){
         glm::vec3 new_position = camera->get_new_position(directions[i], delta_time/sqrt(directions.size()));
         // Without correction /sqrt(directions.size()), we are going faster when moving in 2 directions at the same time (e.g. front and
@@ -79,15 +165,13 @@ void check_for_input(GLFWwindow* window, Camera* camera, Map* map){
 
     // Left or right clicks
     if (Input_listener::left_click){
-        glm::vec4 unprojected = camera->unproject_2D_coord();
-        float depth = unprojected.w;
-        if (depth < MAX_DISTANCE_REMOVE) map->check_remove_cube(glm::vec3(unprojected)); // Remove block corresponding to this position
+        Raycast_hit hit = map->world.raycast(camera->camera_pos, camera->camera_front, MAX_DISTANCE_REMOVE); // Block in the middle of the screen
+        map->check_remove_cube(hit); // Remove block corresponding to this position
         Input_listener::left_click = false;
     }
     else if (Input_listener::right_click){ // Can't have both a left and a right click on the same frame
-        glm::vec4 unprojected = camera->unproject_2D_coord();
-        float depth = unprojected.w;
-        if (depth < MAX_DISTANCE_REMOVE) map->add_cube(glm::vec3(unprojected), texture_num_selected, camera->camera_pos); // Add block (with the selected texture) corresponding to this position
+        Raycast_hit hit = map->world.raycast(camera->camera_pos, camera->camera_front, MAX_DISTANCE_REMOVE);
+        map->add_cube(hit, texture_num_selected, camera->camera_pos); // Add block (with the selected texture) against the face that was hit
         // Give the camera position to "add_cube" for the function to check whether the added cube is not too close to the camera
         Input_listener::right_click = false;
     }
@@ -102,7 +186,51 @@ void check_for_input(GLFWwindow* window, Camera* camera, Map* map){
 }
 
 int main(int argc, char* argv[]){
-    GLFWwindow* window = Window::init_window(NEAR, FAR);
+    // Benchmarks run from the command line, without opening a window
+    if (argc > 1 && std::string(argv[1]) == "--benchmark-noise"){
+        Noise::benchmark();
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--benchmark-regions"){
+        World_save::benchmark("benchmark_save/", TERRAIN_SEED);
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--benchmark-autosave"){
+        World_save::benchmark_autosave("benchmark_autosave/", TERRAIN_SEED);
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--benchmark-journal"){
+        Edit_journal::benchmark("benchmark_journal.bin");
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--benchmark-structures"){
+        Terrain_generator::benchmark(Structure::load_directory(std::string(PATH) + "Structures/"), TERRAIN_SEED);
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--benchmark-culling"){
+        Frustum::benchmark();
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--benchmark-occlusion"){
+        Occlusion_buffer::benchmark();
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--benchmark-lod"){
+        std::array<bool, 256> opaque = {};
+        for (int i = 0; i < files_textures.size(); i++) opaque[i+1] = opaque_texture(files_textures[i]); // Block ID i+1, as registered below
+        Chunk_mesher::benchmark_lod(Terrain_generator(TERRAIN_SEED, Structure::load_directory(std::string(PATH) + "Structures/")), opaque, LOD_DISTANCE);
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--benchmark-render-queue"){
+        Render_queue::benchmark();
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == "--benchmark-bulk"){
+        World::benchmark_bulk();
+        return 0;
+    }
+
+    GLFWwindow* window = Window::init_window(NEAR, FAR(STREAMING_RADIUS));
     Window::loadWindow(window);
 
     // Light source properties
@@ -112,14 +240,29 @@ int main(int argc, char* argv[]){
 
     // Load and create textures
     for (int i = 0; i < files_textures.size(); i++){
-        bool opaque = !(files_textures[i] == "leaf.png" || files_textures[i] == "glass.png"); // Whether this texture is completely opaque or not. Only non-opaque textures are leaves and glass
+        bool opaque = opaque_texture(files_textures[i]);
         Texture texture(path_string + "Textures/" + files_textures[i], textures_shininess[i], opaque, glm::vec3(0.0f), glm::vec3(0.0f), Mirror::resolution); // Previous-to-last 2 arguments are not used for non-mirror textures
+        std::string name = files_textures[i].substr(0, files_textures[i].find('.'));
+        Block_registry::add(name, texture.texture_ID, textures_shininess[i], opaque, false); // Block ID i+1
     }
     stbi_set_flip_vertically_on_load(true);
+    if (argc > 1 && std::string(argv[1]) == "--benchmark-bulk-map"){ // Needs the window, the map drawing its blocks
+        Map map(path_string, "benchmark_bulk_save/", TERRAIN_SEED, STREAMING_RADIUS, STREAMING_IO_THREADS, STREAMING_THREADS, JOURNAL_SYNC_INTERVAL, HISTORY_MAX_EDITS);
+        map.benchmark_bulk(glm::vec3(0.0f, 40.0f, 0.0f));
+        return 0;
+    }
 
     // Create all relevant objects
     Cubemap cubemap(path_string);
-    Map map(NUM_CUBES_SIDE, path_string);
+    Map map(path_string, SAVE_DIRECTORY, TERRAIN_SEED, STREAMING_RADIUS, STREAMING_IO_THREADS, STREAMING_THREADS, JOURNAL_SYNC_INTERVAL, HISTORY_MAX_EDITS);
+    map.greedy_meshing = GREEDY_MESHING;
+    map.lod_distance = LOD_DISTANCE;
+    map.use_render_queue = RENDER_QUEUE;
+    map.connectivity_culling = CONNECTIVITY_CULLING;
+    map.occlusion_culling = OCCLUSION_CULLING;
+    map.prefetch_time = PREFETCH_TIME;
+    map.memory_budget = MEMORY_BUDGET;
+    map.world.enable_occupancy_tree(OCCUPANCY_TREE);
     Input_listener::staticConstructor(window);
     Camera camera(CAMERA_SPEED);
     Target target(path_string);
@@ -146,10 +289,103 @@ int main(int argc, char* argv[]){
         frame_nb++;
         std::cout << "FPS: " << fps() << std::endl;
 
+        // Benchmark of the current meshing mode (triangles_drawn counts all passes: shadows, mirrors and screen)
+        benchmark_time += delta_time;
+        benchmark_frames++;
+        if (benchmark_frames == BENCHMARK_FRAMES){
+            std::cout << (map.greedy_meshing ? "Greedy meshing" : "Instanced cubes") << ", view distance " << Window::far << " blocks: " << 1000*benchmark_time/benchmark_frames << " ms per frame, "
+                      << map.triangles_drawn/benchmark_frames << " triangles per frame" << std::endl;
+            if (map.remesh_count > 0){
+                std::cout << "Remeshed " << map.remesh_count << " chunks after edits and loads, latency from change to new mesh: " << 1000*map.remesh_latency_sum/map.remesh_count << " ms on average, " << 1000*map.remesh_latency_max << " ms at most" << std::endl;
+            }
+            std::cout << "Streaming: " << map.chunks_loaded << " chunks loaded and " << map.chunks_unloaded << " unloaded, " << map.num_pending_columns() << " columns pending" << std::endl;
+            int prefetch_outcomes = map.prefetch_hits + map.prefetch_late + map.prefetch_wasted;
+            std::cout << "Prefetching: " << map.prefetch_requests << " columns requested ahead of the camera, hit rate " << (prefetch_outcomes > 0 ? 100*map.prefetch_hits/prefetch_outcomes : 0) << "% ("
+                      << map.prefetch_hits << " loaded in time, " << map.prefetch_late << " late, " << map.prefetch_wasted << " unused), stalls: " << map.stalled_columns << " columns close to the camera waited "
+                      << 1000*map.stall_time << " ms in total" << std::endl;
+            map.world.print_memory_stats();
+            long long cache_lookups = map.cache.hits + map.cache.misses;
+            std::cout << "Chunk cache: " << map.world.chunks.size() << " chunks resident (" << map.world.memory_bytes()/1024 << " KB), " << map.cache.num_cached_chunks() << " compressed ("
+                      << map.cache.memory_bytes()/1024 << " KB), " << map.cache.evicted_chunks << " evicted, hit ratio " << (cache_lookups > 0 ? 100*map.cache.hits/cache_lookups : 0) << "% of "
+                      << cache_lookups << " column loads" << std::endl;
+            if (OCCUPANCY_TREE) std::cout << "Occupancy tree: " << map.world.occupancy_tree.memory_bytes()/1024 << " KB" << std::endl;
+            std::cout << "Triangles of the loaded map: " << map.count_chunk_mesh_triangles() << " with greedy meshing, " << map.count_instanced_cube_triangles() << " with instanced cubes" << std::endl;
+            std::array<int, 4> lod_chunks = map.count_lod_chunks();
+            std::cout << "Levels of detail: " << lod_chunks[0] << " chunks at full resolution, " << lod_chunks[1] << " at 1/2, " << lod_chunks[2] << " at 1/4, " << lod_chunks[3] << " at 1/8" << std::endl;
+            if (map.greedy_meshing){ // Instanced cubes are drawn from one buffer per block ID for the whole map, so they are not culled
+                std::cout << "Frustum culling, chunks drawn and culled per view: ";
+                std::vector<std::string> view_names = {"camera", "shadow", "mirrors"};
+                for (int kind = 0; kind < Map::num_views; kind++){
+                    std::cout << view_names[kind] << " " << map.chunks_drawn[kind]/benchmark_frames << "/" << map.chunks_culled[kind]/benchmark_frames << (kind == Map::num_views-1 ? "" : ", ");
+                }
+                std::cout << " (per frame, all mirrors together)" << std::endl;
+                if (map.connectivity_culling) std::cout << "Connectivity culling: " << map.chunks_unreachable/benchmark_frames << " chunks of the camera frustum unreachable per frame, "
+                                                        << 1000*map.connectivity_time/benchmark_frames << " ms per frame" << std::endl;
+                if (map.occlusion_culling) std::cout << "Occlusion culling: " << map.chunks_occluded/benchmark_frames << " chunks of the camera frustum hidden per frame, "
+                                                     << 1000*map.occlusion_time/benchmark_frames << " ms per frame" << std::endl;
+            }
+            if (map.greedy_meshing) std::cout << (map.use_render_queue ? "Render queue" : "Drawing pass by pass") << ": " << map.program_binds/benchmark_frames << " program binds, " << map.texture_binds/benchmark_frames
+                                              << " texture binds and " << map.chunk_draw_calls/benchmark_frames << " draw calls per frame for the chunks" << std::endl;
+            map.program_binds = 0;
+            map.texture_binds = 0;
+            map.chunk_draw_calls = 0;
+            map.chunks_unreachable = 0;
+            map.connectivity_time = 0.0;
+            map.chunks_occluded = 0;
+            map.occlusion_time = 0.0;
+            for (int kind = 0; kind < Map::num_views; kind++){
+                map.chunks_drawn[kind] = 0;
+                map.chunks_culled[kind] = 0;
+            }
+            map.triangles_drawn = 0;
+            map.remesh_count = 0;
+            map.remesh_latency_sum = 0.0;
+            map.remesh_latency_max = 0.0;
+            map.chunks_loaded = 0;
+            map.chunks_unloaded = 0;
+            map.prefetch_requests = 0;
+            map.prefetch_hits = 0;
+            map.prefetch_late = 0;
+            map.prefetch_wasted = 0;
+            map.stalled_columns = 0;
+            map.stall_time = 0.0;
+            map.cache.hits = 0;
+            map.cache.misses = 0;
+            map.cache.evicted_chunks = 0;
+            benchmark_time = 0.0;
+            benchmark_frames = 0;
+        }
+
+        // Load the chunks around the camera, then update the meshes of the chunks edited or loaded during last frame, so that changes are visible in this frame
+        map.update_streaming(camera.camera_pos, camera.velocity, camera.movement_front, STREAMING_COLUMNS_PER_FRAME);
+        map.update_chunk_meshes(REMESH_TIME_BUDGET);
+
+        // Autosave: only a snapshot of the modified chunks is taken here, they are written by a background thread while the frames go on
+        if (autosave_running){
+            autosave_frames++;
+            autosave_frame_time_sum += delta_time;
+            autosave_frame_time_max = std::max(autosave_frame_time_max, (double)delta_time);
+            if (!map.saving()){
+                std::cout << "Autosave written in " << 1000*(glfwGetTime() - time_last_autosave) << " ms, during " << autosave_frames << " frames of " << 1000*autosave_frame_time_sum/autosave_frames
+                          << " ms on average and " << 1000*autosave_frame_time_max << " ms at most (" << Chunk::num_copies_on_write << " chunks copied on write)" << std::endl;
+                autosave_running = false;
+            }
+        }
+        else if (glfwGetTime() - time_last_autosave > AUTOSAVE_INTERVAL){
+            time_last_autosave = glfwGetTime();
+            Chunk::num_copies_on_write = 0;
+            int num_columns = map.autosave();
+            std::cout << "Autosave of " << num_columns << " chunk columns, snapshot taken in " << 1000*(glfwGetTime() - time_last_autosave) << " ms" << std::endl;
+            autosave_running = true;
+            autosave_frames = 0;
+            autosave_frame_time_sum = 0.0;
+            autosave_frame_time_max = 0.0;
+        }
+
         // *******************
         // FIRST PASS: computing the shadows
         // *******************
-        glm::mat4 view_light = glm::lookAt(sun.light_pos, glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f)); // View from the sun towards the center of the map
+        glm::mat4 view_light = glm::lookAt(sun.light_pos, camera.camera_pos, glm::vec3(0.0f, 1.0f, 0.0f)); // View from the sun towards the camera, so that the box of projection_light is centered on it
         shadow_shader.use();
         shadow_shader.set_uniform("view", view_light);
         sun.view_light = view_light;
@@ -158,7 +394,7 @@ int main(int argc, char* argv[]){
         glBindFramebuffer(GL_FRAMEBUFFER, Shadow::depth_map_framebuffer);
         glClear(GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT); // clear stencil and depth buffers
         // Draw objects that should have a shadow
-        map.draw_opaque_cubes(view_light, projection_light, sun, camera.camera_pos);
+        map.draw_opaque_cubes(view_light, projection_light, sun, camera.camera_pos, Map::shadow_view);
         map.draw_non_opaque_cubes(view_light, projection_light, sun, camera.camera_pos);
         npc.draw(view_light, projection_light, sun, camera.camera_pos);
 
@@ -168,7 +404,7 @@ int main(int argc, char* argv[]){
         // *******************
         // SECOND PASSES: computing the view from each mirror
         // *******************
-        for (Texture texture: Texture::textures){
+        for (Texture &texture: Texture::textures){
             if (!texture.mirror) continue; // If the texture is not mirror we don't have to compute the view
 
             glBindFramebuffer(GL_FRAMEBUFFER, texture.framebuffer);
@@ -195,7 +431,7 @@ int main(int argc, char* argv[]){
             //axis.draw_axis(view, projection);
             if (SUNNY) sun.draw_sun(view, projection, glfwGetTime(), DAY_DURATION, camera.camera_pos); // Give the camera position to draw the sun at distance 99 of the camera
             // Draw opaque cubes
-            map.draw_opaque_cubes(view, projection, sun, camera.camera_pos); // Give the sun object to draw_cubes to let him read the sun color and position to draw light effectively
+            map.draw_opaque_cubes(view, projection, sun, camera.camera_pos, Map::mirror_view); // Give the sun object to draw_cubes to let him read the sun color and position to draw light effectively
             // Draw NPC
             npc.draw(view, projection, sun, camera.camera_pos);
             // Draw mirrors and their borders
@@ -244,7 +480,7 @@ int main(int argc, char* argv[]){
             glActiveTexture(GL_TEXTURE0);
         }
         // Draw opaque cubes
-        map.draw_opaque_cubes(view, projection, sun, camera.camera_pos); // Give the sun object to draw_cubes to let him read the sun color and position to draw light effectively
+        map.draw_opaque_cubes(view, projection, sun, camera.camera_pos, Map::camera_view); // Give the sun object to draw_cubes to let him read the sun color and position to draw light effectively
         // Draw NPC
         npc.draw(view, projection, sun, camera.camera_pos);
         // Draw mirrors and their borders
@@ -264,6 +500,7 @@ int main(int argc, char* argv[]){
         
         // Checks for inputs signaled by Input_listener (button clicked, mouse clicked or mouse moved)
         check_for_input(window, &camera, &map);
+        camera.update_velocity(delta_time);
 
         glfwPollEvents(); // Checks if an event has been triggered, and if needed calls the corresponding callback
         glfwSwapBuffers(window); // Shows rendering buffer on the screen
@@ -276,6 +513,7 @@ int main(int argc, char* argv[]){
         }
     }
 
+    std::cout << "Saved " << map.checkpoint() << " modified chunk columns" << std::endl;
     glfwTerminate(); // Clean GLFW resources
     return 0;
 }
@@ -9,27 +9,89 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <map>
-#include <vector>
+#include <set>
+#include <deque>
+#include <functional>
+#include <chrono>
+#include <thread>
+#include <climits>
+#include <algorithm>
 #include "Drawable.h"
 #include "Texture.h"
 #include "Shader.h"
 #include "Cube.h"
 #include "Sun.h"
 #include "Mirror.h"
+#include "World.h"
+#include "Instance_buffer.h"
+#include "Chunk_mesher.h"
+#include "Chunk_mesh.h"
+#include "Render_queue.h"
+#include "Terrain_generator.h"
+#include "Chunk_streamer.h"
+#include "World_save.h"
+#include "Edit_journal.h"
+#include "Chunk_cache.h"
+#include "Edit_history.h"
+#include "Block_entities.h"
+#include "Block_registry.h"
+#include "Frustum.h"
 
 class Map: public Drawable{
 public:
-    std::vector<Cube> cubes; // List of the cubes in the map
+    World world; // Blocks of the map, stored per chunk
+    Block_entities block_entities; // Mirrors attached to blocks, destroyed with their block
+    bool greedy_meshing = true; // Whether blocks are drawn with one merged mesh per chunk, or as one instanced cube per block
+    int lod_distance = 4; // Chunk columns at least lod_distance chunks away from the camera along x or z are meshed at half resolution, from 2*lod_distance at a quarter and from 4*lod_distance at an eighth. 0 meshes all of them at full resolution
+    long long triangles_drawn = 0; // Number of triangles drawn since it was last reset (for benchmarking)
+    int remesh_count = 0; // Number of chunks remeshed after an edit or a load since it was last reset, with the sum and maximum of the time between the change and the new mesh being sent to the GPU
+    double remesh_latency_sum = 0.0, remesh_latency_max = 0.0;
+    int chunks_loaded = 0, chunks_unloaded = 0; // Number of chunks streamed in and out since they were last reset
+    double prefetch_time = 2.0; // Columns are also loaded around where the camera will be in prefetch_time s if it keeps moving the same way
+    int prefetch_requests = 0; // Columns requested only because they are ahead of the camera since the counters were last reset
+    int prefetch_hits = 0, prefetch_late = 0, prefetch_wasted = 0; // Prefetched columns loaded before the camera came close to them, still loading when it did, and unloaded without it coming close
+    int stalled_columns = 0; // Columns close to the camera that had to be waited for, and the total time they were waited for in s
+    double stall_time = 0.0;
+    long long memory_budget = 64 << 20; // Bytes that the loaded chunks and the compressed cache of unloaded ones can use together
+    Chunk_cache cache; // Columns unloaded from the world, compressed
+    Edit_history history; // Edits of the player, to undo and redo them
+    enum View{camera_view, shadow_view, mirror_view, num_views}; // Kinds of views the map is drawn in
+    long long chunks_drawn[num_views] = {}, chunks_culled[num_views] = {}; // Chunk meshes drawn, and skipped because they are empty or outside of the view frustum, summed over the views of each kind drawn since they were last reset
+    bool use_render_queue = true; // Whether the faces of the chunk meshes are drawn in the order of their sort keys (see Render_queue), or pass by pass in the order of the loops
+    long long program_binds = 0, texture_binds = 0, chunk_draw_calls = 0; // State changes and draw calls of the chunk passes since they were last reset
+    bool connectivity_culling = true; // Whether the chunk meshes that can't be seen from the camera through non-opaque blocks are skipped in the camera view
+    long long chunks_unreachable = 0; // Chunk meshes in the camera frustum skipped by connectivity culling, and the time in s spent on it, since they were last reset
+    double connectivity_time = 0.0;
+    bool occlusion_culling = true; // Whether the chunk meshes hidden behind the chunks close to the camera are skipped in the camera view
+    long long chunks_occluded = 0; // Chunk meshes in the camera frustum skipped by occlusion culling, and the time in s spent on it, since they were last reset
+    double occlusion_time = 0.0;
 
-    Map(int num_cubes_side, std::string path_to_current_folder):
+    Map(std::string path_to_current_folder, std::string save_directory, int seed, int streaming_radius, int num_io_threads, int num_streaming_threads, double journal_sync_interval, size_t history_max_edits):
         Drawable(Cube::vertices, true, Cube::vertices_indices,{3, 2, 3}),
-        shader(path_to_current_folder + "vertex_shader_texture.txt", path_to_current_folder + "fragment_shader_texture.txt")
-    { // We will create a map of size num_cubes_side x num_cubes_side cubes, with variable altitude
+        history(history_max_edits),
+        shader(path_to_current_folder + "vertex_shader_texture.txt", path_to_current_folder + "fragment_shader_texture.txt"),
+        shader_chunk(path_to_current_folder + "vertex_shader_chunk.txt", path_to_current_folder + "fragment_shader_chunk.txt"),
+        world_save(save_directory),
+        journal(save_directory + "journal.bin", journal_sync_interval),
+        generator(seed, Structure::load_directory(path_to_current_folder + "Structures/")),
+        streamer(generator, &cache, &world_save, num_io_threads, num_streaming_threads)
+    { // The map starts empty, chunks are loaded or generated around the camera by update_streaming
         this->path_to_current_folder = path_to_current_folder;
-        init_map(num_cubes_side); // Init cubes vector
+        this->streaming_radius = streaming_radius;
+        replay_journal(); // Before any column is loaded
+        init_instance_buffers();
+        init_chunk_meshes();
+    }
+
+    ~Map(){
+        world_save.wait_for_saves(); // The saves in progress empty the journal when they end, which is destroyed first
     }
 
-    void draw_opaque_cubes(glm::mat4 view, glm::mat4 projection, Sun sun, glm::vec3 camera_pos){ // Always called first
+    void draw_opaque_cubes(glm::mat4 view, glm::mat4 projection, Sun sun, glm::vec3 camera_pos, View view_kind){ // Always called first
+        if (greedy_meshing){
+            draw_opaque_chunks(view, projection, sun, camera_pos, view_kind);
+            return;
+        }
         shader.use();
         shader.set_uniform("light_color", sun.light_color);
         shader.set_uniform("light_pos", sun.light_pos);
@@ -40,22 +102,22 @@ public:
         shader.set_uniform("projection_light", sun.projection_light);
 
         // First draw only opaque objects (to make sure we see them through non-opaque ones)
-        for (Texture texture: Texture::textures) {
-            if (!texture.opaque || texture.mirror) continue; // Skip non-opaque and mirror objects
-            std::vector<glm::vec3> translations_to_draw;
-            for (Cube cube: cubes) { // Look for all cubes having this texture and put them in vector translations_to_draw
-                if (cube.texture_ID == texture.texture_ID)
-                    translations_to_draw.push_back(glm::vec3(cube.x, cube.y, cube.z));
-            }
-            shader.set_uniform("shininess", texture.shininess);
+        for (int block = 1; block < instance_buffers.size(); block++) {
+            if (Block_registry::transparent[block]) continue; // Skip non-opaque objects
+            shader.set_uniform("shininess", Block_registry::shininess[block]);
             glEnable(GL_CULL_FACE); // Improves computation power and allows to have leaves blocks without flickering
             glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-            draw(translations_to_draw, view, projection, shader, texture.texture_ID, 36, GL_TRIANGLES, true, false);
+            draw_instanced(instance_buffers[block].VBO, instance_buffers[block].size(), view, projection, shader, Block_registry::textures[block], 36, GL_TRIANGLES);
             glDisable(GL_CULL_FACE);
+            triangles_drawn += 12 * instance_buffers[block].size();
         }
     }
 
     void draw_non_opaque_cubes(glm::mat4 view, glm::mat4 projection, Sun sun, glm::vec3 camera_pos){
+        if (greedy_meshing){
+            draw_non_opaque_chunks(view, projection, sun, camera_pos);
+            return;
+        }
         shader.use();
         shader.set_uniform("light_color", sun.light_color);
         shader.set_uniform("light_pos", sun.light_pos);
@@ -66,138 +128,853 @@ public:
         shader.set_uniform("projection_light", sun.projection_light);
 
         // Then draw non-opaque objects starting with the furthest away
-        std::vector<std::pair<float, glm::vec3>> translations_to_draw;
-        std::vector<std::pair<float, Texture>> textures_to_draw;
-        for (Texture texture: Texture::textures) {
-            if (texture.opaque || texture.mirror) continue; // Skip opaque and mirror objects
-            for (Cube cube: cubes) { // Look for all cubes having this texture and put them in vector models_to_draw
-                if (cube.texture_ID == texture.texture_ID){
-                    float distance = glm::length(camera_pos-glm::vec3(cube.x, cube.y, cube.z));
-                    translations_to_draw.push_back(std::make_pair(distance, glm::vec3(cube.x, cube.y, cube.z)));
-                    textures_to_draw.push_back(std::make_pair(distance, texture));
-                }
+        std::vector<Cube_to_draw> cubes_to_draw; // Sorted together so that each translation keeps its block ID
+        for (int block = 1; block < instance_buffers.size(); block++) {
+            if (!Block_registry::transparent[block]) continue; // Skip opaque objects
+            for (glm::vec3 translation: instance_buffers[block].translations) { // Put all blocks of this type in vector cubes_to_draw
+                cubes_to_draw.push_back({glm::length(camera_pos-translation), (uint8_t)block, translation});
             }
         }
 
-        std::sort(translations_to_draw.begin(), translations_to_draw.end(), sort_by_first_val_vec3);
-        std::sort(textures_to_draw.begin(), textures_to_draw.end(), sort_by_first_val_texture);
+        std::sort(cubes_to_draw.begin(), cubes_to_draw.end(), sort_by_distance);
 
         glEnable(GL_CULL_FACE); // Improves computation power and allows to have leaves blocks without flickering
         glEnable(GL_BLEND); // Allows blending of semi-transparent objects
         glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-        for (int i = translations_to_draw.size()-1; i >= 0; i--){
-            shader.set_uniform("shininess", textures_to_draw[i].second.shininess);
-            draw({translations_to_draw[i].second}, view, projection, shader, textures_to_draw[i].second.texture_ID, 36, GL_TRIANGLES, true, false);
+        for (int i = cubes_to_draw.size()-1; i >= 0; i--){
+            uint8_t block = cubes_to_draw[i].block;
+            shader.set_uniform("shininess", Block_registry::shininess[block]);
+            draw({cubes_to_draw[i].translation}, view, projection, shader, Block_registry::textures[block], 36, GL_TRIANGLES, true, false);
         }
+        triangles_drawn += 12 * cubes_to_draw.size();
         glDisable(GL_BLEND);
         glDisable(GL_CULL_FACE);
     }
 
-    void check_remove_cube(glm::vec3 pos) { // Check if the clicked position "pos" corresponds to a cube to remove
-        for (int index = 0; index < cubes.size(); index++) {
-            if (cubes[index].part(pos)){ // Check if position is less than half a block away from center of cube
-                cubes[index].destroy_mirrors_cube();
-                cubes.erase(cubes.begin() + index);
-            }
-
-        }
-    }
-
-    void add_cube(glm::vec3 pos, int texture_num, glm::vec3 position_camera) { // Add the cube corresponding to clicked position "pos"
-        for (int index = 0; index < cubes.size(); index++) {
-            if (cubes[index].part(pos)){ // Check if position is less than half a block away from center of cube
-                // The new cube will be placed alongside cubes[index], but not at the same position, rather just besides it
-                int x_new_cube = cubes[index].x;
-                int y_new_cube = cubes[index].y;
-                int z_new_cube = cubes[index].z;
-                // The direction in which the clicked position is the furthest away from cubes[index] is the direction in which we need to increment coordinate of cubes[index]
-                int x_variation = 0, y_variation = 0, z_variation = 0;
-                if (pos.x - cubes[index].x > 0.49) x_variation++;
-                else if (pos.x - cubes[index].x < -0.49) x_variation--;
-                else if (pos.y - cubes[index].y > 0.49) y_variation++;
-                else if (pos.y - cubes[index].y < -0.49) y_variation--;
-                else if (pos.z - cubes[index].z > 0.49) z_variation++;
-                else if (pos.z - cubes[index].z < -0.49) z_variation--;
-                x_new_cube += x_variation;
-                y_new_cube += y_variation;
-                z_new_cube += z_variation;
-
-                // texture_num takes the special value -1 when asked for a mirror texture
-                if (texture_num == -1){
-                    glm::vec3 mirror_position = glm::vec3(x_new_cube, y_new_cube, z_new_cube);
-                    glm::vec3 mirror_orientation = glm::vec3(x_variation, y_variation, z_variation); // Mirror faces the opposite direction as where the user clicked to place it
-                    std::vector<float> vertices;
-                    if (x_variation > 0) vertices = Mirror::vertices_x_plus;
-                    else if (x_variation > 0) vertices = Mirror::vertices_x_plus;
-                    else if (x_variation < 0) vertices = Mirror::vertices_x_minus;
-                    else if (y_variation > 0) vertices = Mirror::vertices_y_plus;
-                    else if (y_variation < 0) vertices = Mirror::vertices_y_minus;
-                    else if (z_variation > 0) vertices = Mirror::vertices_z_plus;
-                    else if (z_variation < 0) vertices = Mirror::vertices_z_minus;
-                    cubes[index].mirrors.push_back(Mirror(path_to_current_folder, mirror_position, mirror_orientation, vertices));
-                    break; // Since we add a mirror we don't add a cube more
-                }
-                Cube new_cube = Cube(x_new_cube, y_new_cube, z_new_cube, Texture::textures[texture_num].texture_ID);
-                if (new_cube.valid_camera_position(position_camera)) continue; // If the cube is too close to the camera we don't place it, otherwise the camera can't move anymore
-                cubes.push_back(new_cube);
-                break; // If we already added the new cube alongside a cube, we won't place it alongside another one
-            }
+    void check_remove_cube(Raycast_hit hit) { // Remove the block hit by the picking ray, if any
+        if (!hit.hit) return;
+        set_block(hit.block.x, hit.block.y, hit.block.z, Chunk::air);
+    }
+
+    void add_cube(Raycast_hit hit, int texture_num, glm::vec3 position_camera) { // Add a cube against the face of the block hit by the picking ray
+        if (!hit.hit || hit.normal == glm::ivec3(0)) return; // Nothing hit, or the ray started inside a block
+        // The new cube is placed in the empty cell in front of the hit face
+
+        // texture_num takes the special value -1 when asked for a mirror texture
+        if (texture_num == -1){
+            block_entities.get(hit.block.x, hit.block.y, hit.block.z).mirrors.push_back({create_mirror(hit.block, hit.normal), hit.normal});
+            return; // Since we add a mirror we don't add a cube more
         }
+        Cube new_cube = Cube(hit.adjacent.x, hit.adjacent.y, hit.adjacent.z, texture_num+1); // Block IDs are the selected block type plus 1, air being 0
+        if (new_cube.valid_camera_position(position_camera)) return; // If the cube is too close to the camera we don't place it, otherwise the camera can't move anymore
+        set_block(new_cube.x, new_cube.y, new_cube.z, new_cube.block);
+    }
+
+    void begin_transaction(){ // Edits until end_transaction are undone and redone together
+        history.begin_transaction();
+    }
+
+    void end_transaction(){
+        history.end_transaction();
+    }
+
+    void set_blocks(const std::vector<Block_edit> &edits){ // Same as setting the blocks one by one, as one transaction, but patching each instance buffer with one upload
+        history.begin_transaction();
+        apply_edits(edits, true);
+        history.end_transaction();
+    }
+
+    // Bulk edits of the boxes [min, max] (bounds included), each being one transaction. The blocks are changed chunk by chunk by World, then each changed chunk is remeshed once
+    // and each instance buffer patched once. They return the number of blocks changed
+    int fill(glm::ivec3 min, glm::ivec3 max, uint8_t block){
+        if (!box_loaded(min, max)) return 0;
+        std::vector<Block_delta> changes;
+        world.fill(min, max, block, &changes);
+        return apply_bulk_changes(changes);
+    }
+
+    int replace(glm::ivec3 min, glm::ivec3 max, uint8_t from, uint8_t to){
+        if (!box_loaded(min, max)) return 0;
+        std::vector<Block_delta> changes;
+        world.replace(min, max, from, to, &changes);
+        return apply_bulk_changes(changes);
+    }
+
+    int clone(glm::ivec3 min, glm::ivec3 max, glm::ivec3 destination){ // Copies the box so that its corner min goes to destination
+        if (!box_loaded(min, max) || !box_loaded(destination, destination + max - min)) return 0;
+        std::vector<Block_delta> changes;
+        world.paste(world.copy(min, max), destination, &changes);
+        return apply_bulk_changes(changes);
+    }
+
+    int explode(glm::ivec3 center, int radius){ // Removes the blocks at most radius away from block center
+        if (!box_loaded(center - radius, center + radius)) return 0;
+        std::vector<Block_delta> changes;
+        world.remove_sphere(center, radius, &changes);
+        return apply_bulk_changes(changes);
+    }
+
+    int undo(){ // Undoes the last transaction, returns the number of blocks changed
+        return apply_history(true);
+    }
+
+    int redo(){ // Redoes the last undone transaction, returns the number of blocks changed
+        return apply_history(false);
     }
 
     bool part_of_cubes(glm::vec3 pos){ // Checks if the given position is too close to any of the cubes
-        for (Cube cube: cubes) if (cube.valid_camera_position(pos)) return false;
+        // Only the blocks in the neighbourhood of pos can be too close (see Cube::valid_camera_position)
+        for (int x = ceil(pos.x-0.8); x <= floor(pos.x+0.8); x++){
+            for (int y = ceil(pos.y-2); y <= floor(pos.y+0.8); y++){
+                for (int z = ceil(pos.z-0.8); z <= floor(pos.z+0.8); z++){
+                    if (world.solid(x, y, z)) return false;
+                }
+            }
+        }
         return true;
     }
 
+    void update_streaming(glm::vec3 camera_pos, glm::vec3 camera_velocity, glm::vec3 movement_front, int max_columns){ // Loads the chunk columns around the camera and ahead of it, and unloads the ones too far away, inserting at most max_columns columns. Called once per frame
+        double current_time = glfwGetTime();
+        int center_x = World::chunk_coord(round(camera_pos.x)), center_z = World::chunk_coord(round(camera_pos.z));
+        if (center_x != lod_center_x || center_z != lod_center_z) update_levels_of_detail(center_x, center_z);
+        glm::vec2 velocity(camera_velocity.x, camera_velocity.z);
+        glm::vec2 predicted_pos = glm::vec2(camera_pos.x, camera_pos.z) + velocity*(float)prefetch_time;
+        int predicted_x = World::chunk_coord(round(predicted_pos.x)), predicted_z = World::chunk_coord(round(predicted_pos.y));
+        glm::vec2 direction = glm::length(velocity) > 0.5f ? glm::normalize(velocity) : 0.5f*glm::vec2(movement_front.x, movement_front.z); // When not moving, the camera is likelier to move forward
+        auto in_disc = [](int chunk_x, int chunk_z, int disc_x, int disc_z, int radius){ return (chunk_x-disc_x)*(chunk_x-disc_x) + (chunk_z-disc_z)*(chunk_z-disc_z) <= radius*radius; };
+        auto needed = [&](int chunk_x, int chunk_z){ return in_disc(chunk_x, chunk_z, center_x, center_z, streaming_radius); };
+        auto wanted = [&](int chunk_x, int chunk_z, int radius){ return in_disc(chunk_x, chunk_z, center_x, center_z, radius) || in_disc(chunk_x, chunk_z, predicted_x, predicted_z, radius); };
+        auto priority = [&](int chunk_x, int chunk_z){ // Lowest first: close columns ahead of the camera, then the ones behind it and the prefetched ones
+            glm::vec2 offset(chunk_x - center_x, chunk_z - center_z);
+            return glm::length(offset) - 0.75f*glm::dot(offset, direction) + (needed(chunk_x, chunk_z) ? 0 : streaming_radius);
+        };
+        int unload_radius = streaming_radius + 1; // Margin so that moving back and forth around the border doesn't load and unload the same columns
+
+        // Forget the columns that are now too far, whether they are loaded or still queued, saving the ones that were modified and keeping them compressed in the cache
+        streamer.cancel([&](int chunk_x, int chunk_z){ return !wanted(chunk_x, chunk_z, unload_radius); });
+        streamer.reprioritize(priority);
+        for (auto it = requested_columns.begin(); it != requested_columns.end();){
+            if (wanted(it->first.first, it->first.second, unload_radius)){
+                it++;
+                continue;
+            }
+            if (it->second.prefetched) prefetch_wasted++;
+            it = requested_columns.erase(it);
+        }
+        std::vector<int64_t> far_chunks;
+        std::vector<std::pair<int, int>> far_modified_columns;
+        std::map<std::pair<int, int>, Chunk_column> far_columns;
+        for (auto &pair: world.chunks){
+            if (wanted(pair.second.chunk_x, pair.second.chunk_z, unload_radius)) continue;
+            far_chunks.push_back(pair.first);
+            std::pair<int, int> column(pair.second.chunk_x, pair.second.chunk_z);
+            if (modified_columns.erase(column)) far_modified_columns.push_back(column);
+            Chunk_column &far_column = far_columns[column];
+            far_column.chunk_x = column.first;
+            far_column.chunk_z = column.second;
+            far_column.chunks.push_back(pair.second);
+        }
+        save_columns(far_modified_columns);
+        for (auto &pair: far_columns) cache.put(pair.second);
+        for (int64_t key: far_chunks) unload_chunk(key);
+        cache.evict(memory_budget - world.memory_bytes(), center_x, center_z);
+
+        // Columns the camera came close to: a prefetched one is a hit if it is already loaded
+        for (auto &pair: requested_columns){
+            Streamed_column &column = pair.second;
+            if (column.needed_time >= 0.0 || !needed(pair.first.first, pair.first.second)) continue;
+            column.needed_time = current_time;
+            if (column.prefetched){
+                if (column.loaded) prefetch_hits++;
+                else prefetch_late++;
+                column.prefetched = false;
+            }
+        }
+
+        // Insert the columns that are still wanted. A column can be finished twice if it was requested again while being loaded
+        for (Chunk_column &column: streamer.take_finished(max_columns)){
+            auto it = requested_columns.find({column.chunk_x, column.chunk_z});
+            if (it == requested_columns.end() || it->second.loaded) continue;
+            load_column(column);
+            it->second.loaded = true;
+            if (it->second.needed_time >= 0.0){
+                stalled_columns++;
+                stall_time += current_time - it->second.needed_time;
+            }
+        }
+
+        // Request the missing columns around the camera and around where it is going
+        std::vector<std::pair<int, int>> missing_columns;
+        for (int chunk_x = std::min(center_x, predicted_x) - streaming_radius; chunk_x <= std::max(center_x, predicted_x) + streaming_radius; chunk_x++){
+            for (int chunk_z = std::min(center_z, predicted_z) - streaming_radius; chunk_z <= std::max(center_z, predicted_z) + streaming_radius; chunk_z++){
+                if (wanted(chunk_x, chunk_z, streaming_radius) && !requested_columns.count({chunk_x, chunk_z})) missing_columns.push_back(std::make_pair(chunk_x, chunk_z));
+            }
+        }
+        for (std::pair<int, int> missing_column: missing_columns){
+            Streamed_column &column = requested_columns[missing_column];
+            if (needed(missing_column.first, missing_column.second)) column.needed_time = current_time;
+            else{
+                column.prefetched = true;
+                prefetch_requests++;
+            }
+            streamer.request(missing_column.first, missing_column.second, priority(missing_column.first, missing_column.second));
+        }
+    }
+
+    void set_streaming_radius(int streaming_radius){ // Columns out of the new radius are unloaded, and the missing ones requested, by the next update_streaming
+        this->streaming_radius = streaming_radius;
+    }
+
+    int num_pending_columns(){ // Columns requested to the streamer but not inserted yet
+        return streamer.num_pending();
+    }
+
+    int autosave(){ // Saves a snapshot of the modified columns that are loaded (unloaded ones are saved when they are unloaded) in the background, without waiting for the disk
+        // The journal is emptied of the edits made before the snapshot once it is written. Returns the number of columns saved
+        long long journal_position = journal.position();
+        std::vector<std::pair<int, int>> columns(modified_columns.begin(), modified_columns.end());
+        modified_columns.clear(); // Columns edited from now on are saved again by the next autosave
+        save_columns(columns, [this, journal_position]{ journal.discard_before(journal_position); });
+        return columns.size();
+    }
+
+    bool saving(){ // Whether an autosave or the save of unloaded columns is still being written
+        return world_save.saving();
+    }
+
+    int checkpoint(){ // Same as autosave but waits until everything is written, e.g. before exiting
+        int num_columns = autosave();
+        world_save.wait_for_saves();
+        return num_columns;
+    }
+
+    void update_chunk_meshes(double time_budget){ // Remeshes the chunks changed since last frame, spending at most about time_budget seconds. Called once per frame before drawing
+        double start_time = glfwGetTime();
+        std::array<bool, 256> opaque = opaque_blocks();
+        while (!remesh_queue.empty()){ // At least one chunk is remeshed per frame so that the queue always progresses
+            int64_t key = remesh_queue.front();
+            remesh_queue.pop_front();
+            auto it = dirty_chunks.find(key);
+            if (it == dirty_chunks.end()) continue; // The chunk was unloaded since it was queued
+            double edit_time = it->second;
+            dirty_chunks.erase(it);
+            remesh_chunk(key, opaque);
+
+            double current_time = glfwGetTime();
+            double latency = current_time - edit_time;
+            remesh_count++;
+            remesh_latency_sum += latency;
+            remesh_latency_max = std::max(remesh_latency_max, latency);
+            if (current_time - start_time >= time_budget) break; // The rest will be done during the next frames
+        }
+    }
+
+    int count_chunk_mesh_triangles(){ // Number of triangles of all chunk meshes
+        int num_triangles = 0;
+        for (auto &pair: chunk_meshes) num_triangles += pair.second.num_triangles;
+        return num_triangles;
+    }
+
+    std::array<int, 4> count_lod_chunks(){ // Number of chunk meshes at full resolution, and at half, quarter and eighth resolution
+        std::array<int, 4> counts = {};
+        for (auto &pair: chunk_meshes) counts[pair.second.lod_scale == 1 ? 0 : (pair.second.lod_scale == 2 ? 1 : (pair.second.lod_scale == 4 ? 2 : 3))]++;
+        return counts;
+    }
+
+    int count_instanced_cube_triangles(){ // Number of triangles drawn when drawing one instanced cube per block
+        int num_blocks = 0;
+        for (Instance_buffer &instance_buffer: instance_buffers) num_blocks += instance_buffer.size();
+        return 12 * num_blocks;
+    }
+
+    void benchmark_bulk(glm::vec3 camera_pos){ // Prints the number of blocks per second of the bulk edits of the map, including the history, the journal (synced after each edit) or the checkpoint and the instance buffers
+        // The columns around camera_pos are loaded first. The edits are undone at the end, but stay in the journal and in the save directory
+        while (true){
+            update_streaming(camera_pos, glm::vec3(0.0f), glm::vec3(1.0f, 0.0f, 0.0f), 1000);
+            bool all_loaded = !requested_columns.empty();
+            for (auto &pair: requested_columns) all_loaded = all_loaded && pair.second.loaded;
+            if (all_loaded) break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        glm::ivec3 center = glm::ivec3(glm::floor(camera_pos));
+        glm::ivec3 min(center.x - 48, 0, center.z - 48), max(center.x + 47, 63, center.z + 47); // 96 x 64 x 96 blocks, inside the loaded disc
+        long long volume = (long long)(max.x-min.x+1)*(max.y-min.y+1)*(max.z-min.z+1);
+        auto time = [&](std::string name, long long num_blocks, std::function<int()> edit){ // num_blocks is the number of blocks of the edited box, 0 for the number of blocks changed
+            auto start = std::chrono::steady_clock::now();
+            int num_changed = edit();
+            double edit_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            start = std::chrono::steady_clock::now();
+            journal.sync();
+            double sync_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            if (num_blocks == 0) num_blocks = num_changed;
+            std::cout << name << ": " << (long long)(num_blocks/(edit_time + sync_time)/1e6) << " M blocks/s (" << 1000*edit_time << " ms, then " << 1000*sync_time << " ms to sync the journal), "
+                      << num_changed << " blocks changed" << std::endl;
+        };
+        int radius = 20;
+        glm::ivec3 half = (max - min + 1)/2;
+        time("Map fill", volume, [&]{ return fill(min, max, 2); });
+        time("Map replace", volume, [&]{ return replace(min, max, 2, 5); });
+        time("Map clone", volume/8, [&]{ return clone(min, min + half - 1, min + half); });
+        time("Map explode", (long long)(2*radius+1)*(2*radius+1)*(2*radius+1), [&]{ return explode(center, radius); });
+        std::cout << "History: " << history.num_edits() << " edits, " << history.memory_bytes()/1024 << " KB" << std::endl;
+        for (int i = 0; i < 4; i++) time("Map undo", 0, [&]{ return undo(); });
+    }
+
 private:
     Shader shader; // Shader used to draw blocks
+    Shader shader_chunk; // Shader used to draw chunk meshes
     std::string path_to_current_folder;
+    std::vector<Instance_buffer> instance_buffers; // Translations of all blocks of each block ID, kept on the GPU
+    std::unordered_map<int64_t, Chunk_mesh> chunk_meshes; // Mesh of each chunk, keyed like World::chunks
+    std::vector<float> culling_x, culling_y, culling_z; // Centers of the chunks of chunk_meshes, kept between frames to avoid allocations
+    std::vector<uint8_t> culling_visible;
+    std::vector<std::pair<int64_t, Chunk_mesh*>> drawn_meshes; // Chunk meshes drawn by the last draw_opaque_chunks, drawn again by draw_non_opaque_chunks for the same view
+    glm::ivec3 loaded_min = glm::ivec3(0), loaded_max = glm::ivec3(0); // Bounds of the chunks of chunk_meshes, updated by meshes_in_frustum
+    struct Chunk_walk_step{ // Chunk reached by remove_unreachable_meshes
+        glm::ivec3 chunk;
+        int entered_face; // Face through which the chunk was entered, -1 for the chunk of the camera
+        uint8_t directions; // Faces (as directions) crossed on the way from the camera
+    };
+    std::vector<Chunk_walk_step> walk_queue; // Kept between frames to avoid allocations
+    std::unordered_map<int64_t, uint8_t> walk_entered_faces; // Faces through which each chunk was already entered
+    std::unordered_map<int64_t, int> drawn_mesh_indices; // Index in drawn_meshes of each chunk
+    std::vector<uint8_t> drawn_mesh_reached;
+    Occlusion_buffer occlusion_buffer;
+    Render_queue render_queue;
+    static inline const float occluder_distance = 48.0f; // Only the chunks whose center is closer to the camera are drawn in the occlusion buffer
+    static inline const size_t max_journaled_changes = 65536; // Larger bulk edits are saved by a checkpoint, about 850 KB of journal otherwise
+    std::unordered_map<int64_t, double> dirty_chunks; // Chunks whose mesh is out of date, with the time of the first edit since their last remesh
+    std::deque<int64_t> remesh_queue; // Same chunks, in the order in which they were edited
+    int streaming_radius; // Radius in chunks of the disc of columns kept loaded around the camera
+    int lod_center_x = 0, lod_center_z = 0; // Column of the camera when the scales of the chunk meshes were last checked
+    struct Streamed_column{
+        bool loaded = false; // Whether the column is in world, or still being loaded or generated
+        bool prefetched = false; // Whether the column was requested only because it is ahead of the camera, and the camera didn't come close to it yet
+        double needed_time = -1.0; // Time at which the camera came close to the column, -1 if it didn't yet
+    };
+    std::map<std::pair<int, int>, Streamed_column> requested_columns; // Chunk columns (chunk_x, chunk_z) requested to the streamer
+    std::set<std::pair<int, int>> modified_columns; // Loaded columns edited since they were loaded or last saved
+    World_save world_save; // Region files from which columns are loaded, and to which modified columns are saved
+    Edit_journal journal; // Edits since the last checkpoint, to recover the ones that were not saved in the region files after a crash
+    Terrain_generator generator; // Generates the columns that were never saved, on the threads of streamer and when replaying the journal
+    Chunk_streamer streamer; // Declared last so that its threads stop before the rest is destroyed
 
-    void init_map(int num_cubes_side){ // Inits a map with cubes
-        for (int i = -num_cubes_side/2; i < num_cubes_side/2; i++){
-            for (int j = -num_cubes_side/2; j < num_cubes_side/2; j++){
-                // Custom altitude function
-                int altitude = round(cos((2*(float)i+15)/80*M_PI)+cos(((float)j+12)/80*4*M_PI)+4);
+    void set_uniforms_chunks(glm::mat4 view, glm::mat4 projection, Sun sun, glm::vec3 camera_pos){
+        shader_chunk.use();
+        program_binds++;
+        shader_chunk.set_uniform("light_color", sun.light_color);
+        shader_chunk.set_uniform("light_pos", sun.light_pos);
+        shader_chunk.set_uniform("viewing_pos", camera_pos);
+        shader_chunk.set_uniform("texture_uniform", 0); // Bound texture will be put at index 0, so we write as uniform
+        shader_chunk.set_uniform("shadow_texture_uniform", 1);
+        shader_chunk.set_uniform("view_light", sun.view_light);
+        shader_chunk.set_uniform("projection_light", sun.projection_light);
+        shader_chunk.set_uniform("view", view);
+        shader_chunk.set_uniform("projection", projection);
+    }
+
+    void draw_opaque_chunks(glm::mat4 view, glm::mat4 projection, Sun sun, glm::vec3 camera_pos, View view_kind){
+        drawn_meshes = meshes_in_frustum(projection*view);
+        chunks_culled[view_kind] += chunk_meshes.size() - drawn_meshes.size();
+        if (view_kind == camera_view){ // The shadow view is orthographic and mirrors only show a small part of the map
+            if (connectivity_culling) remove_unreachable_meshes(projection*view, camera_pos);
+            if (occlusion_culling) remove_occluded_meshes(projection*view, camera_pos);
+        }
+        chunks_drawn[view_kind] += drawn_meshes.size(); // Counted here only, the non-opaque pass of the same view draws the same chunks
 
-                for (int k = 0; k < altitude; k++){ // Create dirt blocks until altitude-1
-                    Cube cube(i, k, j, Texture::textures[1].texture_ID); // Create a new cube at this position, the altitude being on the y-axis
-                    cubes.push_back(cube);
+        set_uniforms_chunks(view, projection, sun, camera_pos);
+        glEnable(GL_CULL_FACE);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        if (use_render_queue){
+            render_queue.clear();
+            for (std::pair<int64_t, Chunk_mesh*> mesh: drawn_meshes){
+                float distance = glm::length(camera_pos - chunk_center(mesh.first));
+                for (Chunk_mesh_range range: mesh.second->ranges){
+                    if (Block_registry::transparent[range.block]) continue; // Skip non-opaque objects
+                    render_queue.submit({Render_queue::make_key(Render_queue::opaque_pass, shader_chunk.program, Block_registry::textures[range.block], distance), &shader_chunk, mesh.second, range});
                 }
-                // Then create a grass block at altitude
-                Cube cube(i, altitude, j, Texture::textures[0].texture_ID); // Create a new cube at this position, the altitude being on the y-axis
-                cubes.push_back(cube);
-
-                // Add 4 trees on the map at (-7,-12), (-28, 8), (31, -32), and (12, 28) (only if they are in range of the map, i.e. between -num_cubes_side/2 and num_cubes_side/2)
-                if ((i == -7 && j == -12) || (i == -28 && j == 8) || (i == 31 && j == -32) || (i == 12 && j == 28)) {
-                    // Add 6 spruce blocks on top of each other
-                    for (int k = 1; k <= 6; k++) {
-                        Cube cube(i, altitude + k, j, Texture::textures[3].texture_ID);
-                        cubes.push_back(cube);
-                    }
-
-                    // Add leaf blocks: 4 on the altitude+4 level, 8 on the altitude+5 and altitude+6 levels, and 5 on the altitude+7 level
-                    for (int k = 4; k <= 7; k++){
-                        std::vector<std::pair<int, int>> offsets;
-                        if (k == 4) offsets = {{-1,0}, {1,0}, {0,-1}, {0,1}};
-                        if (k == 5 || k == 6) offsets = {{-1,0}, {1,0}, {0,-1}, {0,1}, {-1,-1}, {-1,1}, {1,-1}, {1,1}};
-                        if (k == 7) offsets = {{-1,0}, {1,0}, {0,-1}, {0,1}, {0,0}};
-                        for (std::pair<int, int> offset: offsets) {
-                            Cube cube(i + offset.first, altitude + k, j + offset.second, Texture::textures[5].texture_ID);
-                            cubes.push_back(cube);
-                        }
-                    }
+            }
+            draw_render_queue(&shader_chunk);
+        }
+        else for (int block = 1; block < instance_buffers.size(); block++) { // Bind each texture once and draw its faces in all visible chunks
+            if (Block_registry::transparent[block] || instance_buffers[block].size() == 0) continue; // Skip non-opaque objects
+            shader_chunk.set_uniform("shininess", Block_registry::shininess[block]);
+            glBindTexture(GL_TEXTURE_2D, Block_registry::textures[block]);
+            texture_binds++;
+            for (std::pair<int64_t, Chunk_mesh*> mesh: drawn_meshes){
+                int num_triangles = mesh.second->draw_block(block);
+                triangles_drawn += num_triangles;
+                chunk_draw_calls += num_triangles > 0;
+            }
+        }
+        glDisable(GL_CULL_FACE);
+    }
+
+    void draw_non_opaque_chunks(glm::mat4 view, glm::mat4 projection, Sun sun, glm::vec3 camera_pos){
+        // Chunks are drawn starting with the furthest away, faces inside a chunk are not sorted
+        set_uniforms_chunks(view, projection, sun, camera_pos);
+        glEnable(GL_CULL_FACE);
+        glEnable(GL_BLEND); // Allows blending of semi-transparent objects
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        if (use_render_queue){
+            render_queue.clear();
+            for (std::pair<int64_t, Chunk_mesh*> mesh: drawn_meshes){
+                float distance = glm::length(camera_pos - chunk_center(mesh.first));
+                for (Chunk_mesh_range range: mesh.second->ranges){
+                    if (!Block_registry::transparent[range.block]) continue; // Skip opaque objects
+                    render_queue.submit({Render_queue::make_key(Render_queue::transparent_pass, shader_chunk.program, Block_registry::textures[range.block], distance), &shader_chunk, mesh.second, range});
                 }
             }
+            draw_render_queue(&shader_chunk);
         }
+        else{
+            std::vector<std::pair<float, Chunk_mesh*>> meshes_to_draw;
+            for (std::pair<int64_t, Chunk_mesh*> mesh: drawn_meshes) meshes_to_draw.push_back(std::make_pair(glm::length(camera_pos - chunk_center(mesh.first)), mesh.second));
+            std::sort(meshes_to_draw.begin(), meshes_to_draw.end(), [](const std::pair<float, Chunk_mesh*> &a, const std::pair<float, Chunk_mesh*> &b){ return a.first > b.first; });
+            for (std::pair<float, Chunk_mesh*> mesh_to_draw: meshes_to_draw){
+                for (Chunk_mesh_range range: mesh_to_draw.second->ranges){
+                    if (!Block_registry::transparent[range.block]) continue; // Skip opaque objects
+                    shader_chunk.set_uniform("shininess", Block_registry::shininess[range.block]);
+                    glBindTexture(GL_TEXTURE_2D, Block_registry::textures[range.block]);
+                    texture_binds++;
+                    triangles_drawn += mesh_to_draw.second->draw_range(range);
+                    chunk_draw_calls++;
+                }
+            }
+        }
+        glDisable(GL_BLEND);
+        glDisable(GL_CULL_FACE);
+    }
+
+    void draw_render_queue(Shader* bound_shader){ // Sorts the items of render_queue and draws them, only changing the shader and texture when they differ from the previous item
+        render_queue.sort();
+        unsigned int bound_texture = 0;
+        uint8_t shininess_block = Chunk::air; // Block whose shininess is set in bound_shader
+        for (const Render_item &item: render_queue.items){
+            if (item.shader != bound_shader){
+                bound_shader = item.shader;
+                bound_shader->use();
+                program_binds++;
+                shininess_block = Chunk::air;
+            }
+            if (item.range.block != shininess_block){
+                shininess_block = item.range.block;
+                bound_shader->set_uniform("shininess", Block_registry::shininess[item.range.block]);
+            }
+            unsigned int texture = Block_registry::textures[item.range.block];
+            if (texture != bound_texture){
+                bound_texture = texture;
+                glBindTexture(GL_TEXTURE_2D, texture);
+                texture_binds++;
+            }
+            triangles_drawn += item.mesh->draw_range(item.range);
+            chunk_draw_calls++;
+        }
+    }
+
+    glm::vec3 chunk_center(int64_t key){ // Center of a loaded chunk in world coordinates
+        Chunk &chunk = world.chunks.at(key);
+        return (glm::vec3(chunk.chunk_x, chunk.chunk_y, chunk.chunk_z) + 0.5f) * (float)Chunk::size - 0.5f; // Blocks are centered on integer coordinates
+    }
+
+    std::vector<std::pair<int64_t, Chunk_mesh*>> meshes_in_frustum(glm::mat4 view_projection){ // Non-empty chunk meshes (with their key) whose chunk is at least partly in the view frustum
+        // The centers of the chunks are gathered in one array per coordinate, and tested 4 by 4 by Frustum::cull
+        std::vector<std::pair<int64_t, Chunk_mesh*>> meshes;
+        meshes.reserve(chunk_meshes.size());
+        culling_x.clear();
+        culling_y.clear();
+        culling_z.clear();
+        bool first = true;
+        for (auto &pair: chunk_meshes){
+            Chunk &chunk = world.chunks.at(pair.first);
+            glm::ivec3 coords(chunk.chunk_x, chunk.chunk_y, chunk.chunk_z);
+            loaded_min = first ? coords : glm::min(loaded_min, coords);
+            loaded_max = first ? coords : glm::max(loaded_max, coords);
+            first = false;
+            if (pair.second.num_triangles == 0) continue; // Nothing to draw, and its blocks (if any) are hidden by the ones of its neighbours
+            glm::vec3 center = (glm::vec3(coords) + 0.5f) * (float)Chunk::size - 0.5f; // Blocks are centered on integer coordinates
+            culling_x.push_back(center.x);
+            culling_y.push_back(center.y);
+            culling_z.push_back(center.z);
+            meshes.push_back(std::make_pair(pair.first, &pair.second));
+        }
+        culling_visible.resize(meshes.size());
+        if (meshes.empty()) return meshes;
+        Frustum(view_projection).cull(&culling_x[0], &culling_y[0], &culling_z[0], meshes.size(), 0.5f*Chunk::size, &culling_visible[0]);
+        int num_visible = 0;
+        for (int i = 0; i < meshes.size(); i++) if (culling_visible[i]) meshes[num_visible++] = meshes[i];
+        meshes.resize(num_visible);
+        return meshes;
+    }
+
+    void remove_unreachable_meshes(glm::mat4 view_projection, glm::vec3 camera_pos){ // Removes from drawn_meshes the chunks that can't be seen from the camera through non-opaque blocks
+        // Walks from the chunk of the camera to the neighbours of each chunk through the faces connected to the face it was entered by, without going in a direction
+        // opposite to one already taken and staying in the frustum. A chunk is walked again if it is entered by another face. Positions without mesh are walked as empty chunks
+        double start_time = glfwGetTime();
+        Frustum frustum(view_projection);
+        drawn_mesh_indices.clear();
+        for (int i = 0; i < drawn_meshes.size(); i++) drawn_mesh_indices[drawn_meshes[i].first] = i;
+        drawn_mesh_reached.assign(drawn_meshes.size(), false);
+        glm::ivec3 start(World::chunk_coord((int)std::floor(camera_pos.x + 0.5f)), World::chunk_coord((int)std::floor(camera_pos.y + 0.5f)), World::chunk_coord((int)std::floor(camera_pos.z + 0.5f))); // Blocks are centered on integer coordinates
+        glm::ivec3 walk_min = glm::min(loaded_min, start) - 1, walk_max = glm::max(loaded_max, start) + 1; // Around the loaded chunks, so that the walk can go around them
+        walk_queue.clear();
+        walk_entered_faces.clear();
+        walk_queue.push_back({start, -1, 0});
+        for (size_t next = 0; next < walk_queue.size(); next++){
+            Chunk_walk_step step = walk_queue[next];
+            int64_t key = World::chunk_key(step.chunk.x, step.chunk.y, step.chunk.z);
+            auto index = drawn_mesh_indices.find(key);
+            if (index != drawn_mesh_indices.end()) drawn_mesh_reached[index->second] = true;
+            auto mesh = chunk_meshes.find(key);
+            const uint8_t* links = mesh == chunk_meshes.end() ? nullptr : mesh->second.connectivity.links;
+            for (int face = 0; face < Chunk_connectivity::num_faces; face++){
+                if (step.entered_face >= 0 && links != nullptr && !((links[step.entered_face] >> face) & 1)) continue;
+                if ((step.directions >> (face^1)) & 1) continue; // Going back towards the camera
+                glm::ivec3 neighbour = step.chunk + Chunk_connectivity::direction(face);
+                if (glm::any(glm::lessThan(neighbour, walk_min)) || glm::any(glm::greaterThan(neighbour, walk_max))) continue;
+                uint8_t &entered_faces = walk_entered_faces[World::chunk_key(neighbour.x, neighbour.y, neighbour.z)];
+                if ((entered_faces >> (face^1)) & 1) continue; // Already entered by this face
+                if (!frustum.intersects((glm::vec3(neighbour) + 0.5f) * (float)Chunk::size - 0.5f, 0.5f*Chunk::size)) continue;
+                entered_faces |= 1 << (face^1);
+                walk_queue.push_back({neighbour, face^1, (uint8_t)(step.directions | (1 << face))});
+            }
+        }
+        int num_reached = 0;
+        for (int i = 0; i < drawn_meshes.size(); i++) if (drawn_mesh_reached[i]) drawn_meshes[num_reached++] = drawn_meshes[i];
+        chunks_unreachable += drawn_meshes.size() - num_reached;
+        drawn_meshes.resize(num_reached);
+        connectivity_time += glfwGetTime() - start_time;
+    }
+
+    void remove_occluded_meshes(glm::mat4 view_projection, glm::vec3 camera_pos){ // Removes from drawn_meshes the chunks hidden behind the opaque blocks of the chunks close to the camera
+        double start_time = glfwGetTime();
+        occlusion_buffer.clear(view_projection, camera_pos);
+        for (std::pair<int64_t, Chunk_mesh*> mesh: drawn_meshes){
+            if (mesh.second->occluders.empty()) continue;
+            Chunk &chunk = world.chunks.at(mesh.first);
+            glm::vec3 center = (glm::vec3(chunk.chunk_x, chunk.chunk_y, chunk.chunk_z) + 0.5f) * (float)Chunk::size - 0.5f;
+            if (glm::length(center - camera_pos) > occluder_distance) continue;
+            for (const Occluder_box &box: mesh.second->occluders) occlusion_buffer.add_occluder(box);
+        }
+        int num_visible = 0;
+        for (int i = 0; i < drawn_meshes.size(); i++){
+            Chunk &chunk = world.chunks.at(drawn_meshes[i].first);
+            glm::vec3 min = glm::vec3(chunk.chunk_x, chunk.chunk_y, chunk.chunk_z) * (float)Chunk::size - 0.5f;
+            if (occlusion_buffer.visible(min, min + (float)Chunk::size)) drawn_meshes[num_visible++] = drawn_meshes[i];
+        }
+        chunks_occluded += drawn_meshes.size() - num_visible;
+        drawn_meshes.resize(num_visible);
+        occlusion_time += glfwGetTime() - start_time;
+    }
+
+    std::array<bool, 256> opaque_blocks(){ // Whether each block ID hides the blocks behind it
+        std::array<bool, 256> opaque;
+        opaque.fill(false);
+        for (int block = 1; block < Block_registry::size(); block++) opaque[block] = Block_registry::opaque[block];
+        return opaque;
+    }
+
+    int lod_scale(int chunk_x, int chunk_z){ // Scale at which the chunks of column (chunk_x, chunk_z) are meshed
+        return Chunk_mesher::lod_scale(std::max(std::abs(chunk_x - lod_center_x), std::abs(chunk_z - lod_center_z)), lod_distance);
+    }
+
+    uint8_t lod_air_sides(int chunk_x, int chunk_z){ // Sides of a full resolution column against columns meshed at another scale (see Chunk_mesher::mesh_chunk)
+        int scale = lod_scale(chunk_x, chunk_z);
+        if (scale != 1) return 0; // The sides of downsampled chunks are always meshed against air
+        uint8_t air_sides = 0;
+        if (lod_scale(chunk_x - 1, chunk_z) != scale) air_sides |= Chunk_mesher::negative_x_side;
+        if (lod_scale(chunk_x + 1, chunk_z) != scale) air_sides |= Chunk_mesher::positive_x_side;
+        if (lod_scale(chunk_x, chunk_z - 1) != scale) air_sides |= Chunk_mesher::negative_z_side;
+        if (lod_scale(chunk_x, chunk_z + 1) != scale) air_sides |= Chunk_mesher::positive_z_side;
+        return air_sides;
+    }
+
+    void update_levels_of_detail(int center_x, int center_z){ // Queues the chunks whose scale or sides against other scales changed because the camera moved to column (center_x, center_z)
+        lod_center_x = center_x;
+        lod_center_z = center_z;
+        for (auto &pair: chunk_meshes){
+            Chunk &chunk = world.chunks.at(pair.first);
+            if (lod_scale(chunk.chunk_x, chunk.chunk_z) != pair.second.lod_scale || lod_air_sides(chunk.chunk_x, chunk.chunk_z) != pair.second.air_sides) mark_dirty(chunk.chunk_x, chunk.chunk_y, chunk.chunk_z);
+        }
+    }
+
+    void remesh_chunk(int64_t key, const std::array<bool, 256> &opaque){ // Rebuilds the mesh of a chunk after it changed, at the scale of its distance to the camera
+        auto it = world.chunks.find(key);
+        if (it == world.chunks.end()) return;
+        int scale = lod_scale(it->second.chunk_x, it->second.chunk_z);
+        uint8_t air_sides = lod_air_sides(it->second.chunk_x, it->second.chunk_z);
+        Chunk_mesh_data data = scale == 1 ? Chunk_mesher::mesh_chunk(world, it->second, opaque, air_sides) : Chunk_mesher::mesh_chunk_lod(world, it->second, opaque, scale);
+        Chunk_mesh &mesh = chunk_meshes[key];
+        mesh.upload(data);
+        mesh.lod_scale = scale;
+        mesh.air_sides = air_sides;
+        mesh.connectivity = Chunk_connectivity::compute(it->second, opaque);
+        mesh.occluders.clear();
+        Occlusion_buffer::add_chunk_occluders(it->second, opaque, mesh.occluders);
+    }
+
+    void mark_dirty(int chunk_x, int chunk_y, int chunk_z){ // Queues the chunk to be remeshed by update_chunk_meshes
+        int64_t key = World::chunk_key(chunk_x, chunk_y, chunk_z);
+        if (dirty_chunks.count(key) || !world.chunks.count(key)) return; // Already queued, or nothing to mesh
+        dirty_chunks[key] = glfwGetTime();
+        remesh_queue.push_back(key);
+    }
+
+    void init_chunk_meshes(){
+        std::array<bool, 256> opaque = opaque_blocks();
+        for (auto &pair: world.chunks) remesh_chunk(pair.first, opaque);
+    }
+
+    bool column_loaded(int chunk_x, int chunk_z){ // Edits are only made to loaded columns: load_column would replace the chunks of the others, and with them the edits
+        auto it = requested_columns.find(std::make_pair(chunk_x, chunk_z));
+        return it != requested_columns.end() && it->second.loaded;
+    }
+
+    bool box_loaded(glm::ivec3 min, glm::ivec3 max){ // Whether all the columns of the box [min, max] are loaded, printing a message if not
+        for (int chunk_x = World::chunk_coord(min.x); chunk_x <= World::chunk_coord(max.x); chunk_x++){
+            for (int chunk_z = World::chunk_coord(min.z); chunk_z <= World::chunk_coord(max.z); chunk_z++){
+                if (column_loaded(chunk_x, chunk_z)) continue;
+                std::cout << "Cannot edit chunks that are not loaded" << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void set_block(int x, int y, int z, uint8_t block){ // Changes a block of the world and patches the instance buffers accordingly
+        if (!column_loaded(World::chunk_coord(x), World::chunk_coord(z))) return;
+        uint8_t old_block = world.get(x, y, z);
+        if (old_block == block) return;
+        if (block == Chunk::air && !block_entities.empty()) block_entities.destroy(x, y, z); // Mirrors attached to a removed block go with it
+        int64_t key = World::block_key(x, y, z);
+        if (old_block != Chunk::air) instance_buffers[old_block].remove(key);
+        world.set(x, y, z, block);
+        if (block != Chunk::air) instance_buffers[block].add(key, glm::vec3(x, y, z));
+        history.record(x, y, z, old_block, block);
+        modified_columns.insert(std::make_pair(World::chunk_coord(x), World::chunk_coord(z)));
+        journal.append(x, y, z, block);
+        mark_dirty_block(x, y, z);
+    }
+
+    void apply_edits(const std::vector<Block_edit> &edits, bool record){ // Sets the blocks in order, then updates the rest of the map with apply_changes
+        std::vector<Block_delta> changes;
+        changes.reserve(edits.size());
+        for (Block_edit edit: edits){
+            if (!column_loaded(World::chunk_coord(edit.x), World::chunk_coord(edit.z))) continue;
+            uint8_t old_block = world.get(edit.x, edit.y, edit.z);
+            if (old_block == edit.block) continue;
+            world.set(edit.x, edit.y, edit.z, edit.block);
+            changes.push_back({edit.x, edit.y, edit.z, old_block, edit.block});
+        }
+        apply_changes(changes, record, true);
+    }
+
+    void apply_changes(const std::vector<Block_delta> &changes, bool record, bool repeated_blocks){ // Updates what depends on the blocks after they were changed in world: history (if record is true),
+        // journal, remesh queue, mirrors and instance buffers, patched once per block ID. repeated_blocks tells whether a block can be changed several times in changes
+        // More than max_journaled_changes are saved by a checkpoint instead of being journaled one record per block
+        bool journaled = changes.size() <= max_journaled_changes;
+        std::vector<Block_edit> journal_edits;
+        if (journaled) journal_edits.reserve(changes.size());
+        std::pair<int, int> last_column(INT_MIN, INT_MIN);
+        for (const Block_delta &change: changes){
+            if (change.new_block == Chunk::air && !block_entities.empty()) block_entities.destroy(change.x, change.y, change.z);
+            if (record) history.record(change.x, change.y, change.z, change.old_block, change.new_block);
+            std::pair<int, int> column(World::chunk_coord(change.x), World::chunk_coord(change.z));
+            if (column != last_column) modified_columns.insert(column); // Changes usually come chunk by chunk
+            last_column = column;
+            if (journaled) journal_edits.push_back({change.x, change.y, change.z, change.new_block});
+            mark_dirty_block(change.x, change.y, change.z);
+        }
+        if (journaled) journal.append_all(journal_edits);
+        else checkpoint(); // The snapshot includes the changes, and the journal is trimmed of the edits before them
+
+        std::vector<std::vector<int64_t>> removed_per_id(instance_buffers.size());
+        std::vector<std::vector<std::pair<int64_t, glm::vec3>>> added_per_id(instance_buffers.size());
+        auto add_change = [&](int64_t key, int x, int y, int z, uint8_t old_block, uint8_t new_block){
+            if (old_block == new_block) return;
+            if (old_block != Chunk::air) removed_per_id[old_block].push_back(key);
+            if (new_block != Chunk::air) added_per_id[new_block].push_back(std::make_pair(key, glm::vec3(x, y, z)));
+        };
+        if (repeated_blocks){ // Only the block before the first change and after the last one matter for the instance buffers
+            std::unordered_map<int64_t, Block_delta> changed_blocks;
+            changed_blocks.reserve(changes.size());
+            for (const Block_delta &change: changes){
+                auto it = changed_blocks.find(World::block_key(change.x, change.y, change.z));
+                if (it == changed_blocks.end()) changed_blocks[World::block_key(change.x, change.y, change.z)] = change;
+                else it->second.new_block = change.new_block;
+            }
+            for (auto &pair: changed_blocks) add_change(pair.first, pair.second.x, pair.second.y, pair.second.z, pair.second.old_block, pair.second.new_block);
+        }
+        else for (const Block_delta &change: changes) add_change(World::block_key(change.x, change.y, change.z), change.x, change.y, change.z, change.old_block, change.new_block);
+        for (int block = 1; block < instance_buffers.size(); block++){
+            if (!removed_per_id[block].empty()) instance_buffers[block].remove_all(removed_per_id[block]);
+            if (!added_per_id[block].empty()) instance_buffers[block].add_all(added_per_id[block]);
+        }
+    }
+
+    int apply_bulk_changes(const std::vector<Block_delta> &changes){
+        history.begin_transaction();
+        apply_changes(changes, true, false); // Bulk edits change each block at most once
+        history.end_transaction();
+        return changes.size();
     }
 
-    static bool sort_by_first_val_vec3(std::pair<float, glm::vec3> &a, std::pair<float, glm::vec3> &b){
-        return (a.first < b.first);
+    int apply_history(bool undo){ // Applies the last transaction of history backwards (undo) or the last undone one forwards (redo), if all its blocks are loaded
+        std::vector<Block_delta> changes;
+        if (undo ? !history.undo(changes) : !history.redo(changes)) return 0;
+        for (const Block_delta &change: changes){
+            if (column_loaded(World::chunk_coord(change.x), World::chunk_coord(change.z))) continue;
+            std::vector<Block_delta> ignored;
+            if (undo) history.redo(ignored); // Back to where it was, the blocks can be changed when the camera comes back
+            else history.undo(ignored);
+            std::cout << "Cannot " << (undo ? "undo" : "redo") << " edits of chunks that are not loaded anymore" << std::endl;
+            return 0;
+        }
+        std::vector<Block_edit> edits;
+        edits.reserve(changes.size());
+        for (const Block_delta &change: changes) edits.push_back({change.x, change.y, change.z, change.new_block});
+        apply_edits(edits, false);
+        return edits.size();
     }
 
-    static bool sort_by_first_val_texture(std::pair<float, Texture> &a, std::pair<float, Texture> &b){
-        return (a.first < b.first);
+    void mark_dirty_block(int x, int y, int z){ // Queues the chunk of the block, and the neighbouring chunks whose faces touch it
+        int chunk_x = World::chunk_coord(x), chunk_y = World::chunk_coord(y), chunk_z = World::chunk_coord(z);
+        mark_dirty(chunk_x, chunk_y, chunk_z);
+        int local_x = World::local_coord(x), local_y = World::local_coord(y), local_z = World::local_coord(z);
+        if (local_x == 0) mark_dirty(chunk_x-1, chunk_y, chunk_z);
+        if (local_x == Chunk::size-1) mark_dirty(chunk_x+1, chunk_y, chunk_z);
+        if (local_y == 0) mark_dirty(chunk_x, chunk_y-1, chunk_z);
+        if (local_y == Chunk::size-1) mark_dirty(chunk_x, chunk_y+1, chunk_z);
+        if (local_z == 0) mark_dirty(chunk_x, chunk_y, chunk_z-1);
+        if (local_z == Chunk::size-1) mark_dirty(chunk_x, chunk_y, chunk_z+1);
+    }
+
+    void init_instance_buffers(){ // Fills the instance buffers with the blocks of the world, uploading each buffer once
+        instance_buffers.resize(Block_registry::size()); // Index 0 (air) is never used
+        world.for_each_block([&](int x, int y, int z, uint8_t block){
+            instance_buffers[block].append(World::block_key(x, y, z), glm::vec3(x, y, z));
+        });
+        for (Instance_buffer &instance_buffer: instance_buffers) instance_buffer.upload_all();
+    }
+
+    void load_column(Chunk_column &column){ // Inserts generated chunks in the world, the instance buffers and the remesh queue
+        std::vector<std::vector<std::pair<int64_t, glm::vec3>>> blocks_per_id(instance_buffers.size());
+        for (Chunk &chunk: column.chunks){
+            unload_chunk(World::chunk_key(chunk.chunk_x, chunk.chunk_y, chunk.chunk_z)); // Not expected since edits are refused until the column is loaded, but never keep two copies of a chunk
+            chunk.for_each_block([&](int x, int y, int z, uint8_t block){
+                blocks_per_id[block].push_back(std::make_pair(World::block_key(x, y, z), glm::vec3(x, y, z)));
+            });
+            world.insert_chunk(chunk);
+            block_entities.load_chunk(chunk.chunk_x, chunk.chunk_y, chunk.chunk_z, [&](const Block_entity &entity, glm::ivec3 normal){
+                return create_mirror(glm::ivec3(entity.x, entity.y, entity.z), normal);
+            });
+            chunks_loaded++;
+        }
+        for (int block = 1; block < instance_buffers.size(); block++) if (!blocks_per_id[block].empty()) instance_buffers[block].add_all(blocks_per_id[block]);
+
+        // Mesh the new chunks, and remesh their neighbours whose faces against them may now be hidden
+        for (Chunk &chunk: column.chunks) mark_dirty_with_neighbours(chunk.chunk_x, chunk.chunk_y, chunk.chunk_z);
+    }
+
+    unsigned int create_mirror(glm::ivec3 block, glm::ivec3 normal){ // Creates a mirror on the face normal of block, returning the texture ID of the mirror
+        glm::vec3 mirror_position = glm::vec3(block + normal);
+        glm::vec3 mirror_orientation = glm::vec3(normal); // Mirror faces the same direction as the face the user clicked to place it
+        std::vector<float> vertices;
+        if (normal.x > 0) vertices = Mirror::vertices_x_plus;
+        else if (normal.x < 0) vertices = Mirror::vertices_x_minus;
+        else if (normal.y > 0) vertices = Mirror::vertices_y_plus;
+        else if (normal.y < 0) vertices = Mirror::vertices_y_minus;
+        else if (normal.z > 0) vertices = Mirror::vertices_z_plus;
+        else vertices = Mirror::vertices_z_minus;
+        Mirror mirror(path_to_current_folder, mirror_position, mirror_orientation, vertices);
+        return mirror.texture.texture_ID;
+    }
+
+    void unload_chunk(int64_t key){ // Removes a chunk from the world with its blocks, mirrors and mesh. The mirrors are created again when it is loaded back
+        auto it = world.chunks.find(key);
+        if (it == world.chunks.end()) return;
+        Chunk &chunk = it->second;
+        int chunk_x = chunk.chunk_x, chunk_y = chunk.chunk_y, chunk_z = chunk.chunk_z;
+
+        std::vector<std::vector<int64_t>> keys_per_id(instance_buffers.size());
+        chunk.for_each_block([&](int x, int y, int z, uint8_t block){ keys_per_id[block].push_back(World::block_key(x, y, z)); });
+        for (int block = 1; block < instance_buffers.size(); block++) if (!keys_per_id[block].empty()) instance_buffers[block].remove_all(keys_per_id[block]);
+        block_entities.unload_chunk(chunk_x, chunk_y, chunk_z);
+        auto mesh = chunk_meshes.find(key);
+        if (mesh != chunk_meshes.end()){
+            mesh->second.destroy();
+            chunk_meshes.erase(mesh);
+        }
+        dirty_chunks.erase(key); // Its key is skipped when reached in remesh_queue
+
+        world.remove_chunk(chunk_x, chunk_y, chunk_z);
+        chunks_unloaded++;
+        mark_dirty_with_neighbours(chunk_x, chunk_y, chunk_z); // The faces of the neighbours against the removed chunk become visible
+    }
+
+    void replay_journal(){ // Applies the edits of the journal to the saved (or generated) columns, saves them and empties the journal
+        // Edits are replayed in order over the saved columns, which might already contain some of them: the last edit of each block always wins
+        std::vector<Block_edit> edits = journal.read_all();
+        if (edits.empty()) return;
+        World replayed;
+        std::set<std::pair<int, int>> columns;
+        for (Block_edit edit: edits){
+            std::pair<int, int> column(World::chunk_coord(edit.x), World::chunk_coord(edit.z));
+            if (columns.insert(column).second){
+                Chunk_column chunks;
+                if (!world_save.load_column(column.first, column.second, chunks)) chunks.chunks = generator.generate_column(column.first, column.second);
+                for (Chunk &chunk: chunks.chunks) replayed.insert_chunk(chunk);
+            }
+            replayed.set(edit.x, edit.y, edit.z, edit.block);
+        }
+        std::map<std::pair<int, int>, Chunk_column> columns_to_save;
+        for (std::pair<int, int> column: columns) columns_to_save[column] = {column.first, column.second, {}};
+        for (auto &pair: replayed.chunks) columns_to_save[std::make_pair(pair.second.chunk_x, pair.second.chunk_z)].chunks.push_back(pair.second);
+        std::vector<Chunk_column> saved_columns;
+        for (auto &pair: columns_to_save) saved_columns.push_back(pair.second);
+        if (world_save.save_columns(saved_columns) > 0){ // Replayed again at the next start
+            std::cout << "Could not save the edits of the journal, they are kept in it" << std::endl;
+            return;
+        }
+        journal.clear();
+        std::cout << "Replayed " << edits.size() << " edits of the journal in " << columns.size() << " chunk columns" << std::endl;
+    }
+
+    void save_columns(const std::vector<std::pair<int, int>> &columns, std::function<void()> on_saved = nullptr){ // Saves the loaded chunks of these columns from the background thread of world_save
+        // The chunks are copied, which only shares their blocks: the world is snapshotted in a few ms and edits copy the chunks they modify until they are written
+        if (columns.empty() && !on_saved) return;
+        std::map<std::pair<int, int>, int> index_of_column;
+        std::vector<Chunk_column> columns_to_save;
+        for (std::pair<int, int> column: columns){
+            index_of_column[column] = columns_to_save.size();
+            columns_to_save.push_back({column.first, column.second, {}});
+        }
+        for (auto &pair: world.chunks){
+            auto it = index_of_column.find(std::make_pair(pair.second.chunk_x, pair.second.chunk_z));
+            if (it != index_of_column.end()) columns_to_save[it->second].chunks.push_back(pair.second);
+        }
+        world_save.save_columns_async(std::move(columns_to_save), on_saved);
+    }
+
+    void mark_dirty_with_neighbours(int chunk_x, int chunk_y, int chunk_z){
+        mark_dirty(chunk_x, chunk_y, chunk_z);
+        mark_dirty(chunk_x-1, chunk_y, chunk_z);
+        mark_dirty(chunk_x+1, chunk_y, chunk_z);
+        mark_dirty(chunk_x, chunk_y-1, chunk_z);
+        mark_dirty(chunk_x, chunk_y+1, chunk_z);
+        mark_dirty(chunk_x, chunk_y, chunk_z-1);
+        mark_dirty(chunk_x, chunk_y, chunk_z+1);
+    }
+
+    struct Cube_to_draw{ // Non-opaque cube drawn by draw_non_opaque_cubes
+        float distance; // From the camera
+        uint8_t block;
+        glm::vec3 translation;
+    };
+
+    static bool sort_by_distance(const Cube_to_draw &a, const Cube_to_draw &b){
+        return (a.distance < b.distance);
     }
 };
 #endif
\ No newline at end of file
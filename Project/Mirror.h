@@ -7,6 +7,7 @@
 #include <glm/glm.hpp>
 #include <array>
 #include <vector>
+#include <unordered_map>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include "Sun.h"
@@ -20,6 +21,7 @@ public:
 
     static inline int resolution = 1000; // Default value of mirrors resolution
     static inline std::vector<Mirror> mirrors;
+    static inline std::unordered_map<unsigned int, int> indices; // Index in mirrors of each mirror, by the texture_ID of its texture
 
     static inline std::vector<float> vertices_x_plus = { // Vertices for a mirror facing the X+ direction
             // First 3 are 3D positions, next 2 are texture positions, final 3 are normal vector components
@@ -79,8 +81,21 @@ public:
         
     {
         this->position = position;
+        Mirror::indices[texture.texture_ID] = Mirror::mirrors.size();
         Mirror::mirrors.push_back(*this);
-        
+    }
+
+    static void destroy(unsigned int texture_ID){ // Removes the mirror whose texture is texture_ID and its texture in constant time, so that its view isn't computed anymore
+        auto it = Mirror::indices.find(texture_ID);
+        if (it == Mirror::indices.end()) return;
+        int index = it->second;
+        Mirror::indices.erase(it);
+        if (index != Mirror::mirrors.size()-1){ // The order in which mirrors are drawn doesn't matter
+            Mirror::mirrors[index] = Mirror::mirrors.back();
+            Mirror::indices[Mirror::mirrors[index].texture.texture_ID] = index;
+        }
+        Mirror::mirrors.pop_back();
+        Texture::remove(texture_ID);
     }
 
     void draw_mirror(glm::mat4 view, glm::mat4 projection, Sun sun, glm::vec3 camera_pos){
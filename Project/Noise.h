@@ -0,0 +1,436 @@
+#ifndef NOISE_H
+#define NOISE_H
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <chrono>
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define NOISE_SIMD // SSE2 and AVX2 versions are compiled with target attributes and chosen at runtime, whatever the flags of the rest of the program
+#include <immintrin.h>
+#endif
+
+struct Fbm{ // Fractal sum of octaves of noise: sum of gain^o * noise(frequency * lacunarity^o * position) for o in [0, octaves)
+    int octaves = 4;
+    float frequency = 1.0f;
+    float lacunarity = 2.0f;
+    float gain = 0.5f;
+};
+
+class Noise{ // Seeded gradient noise in 2D and 3D, and their fBm filled on whole grids at once
+    // Every version does exactly the same float operations in the same order (no FMA, floor and hash done with integers)
+    // so that the scalar, SSE2 and AVX2 versions give bit-for-bit identical results, and the terrain doesn't depend on the CPU
+public:
+    enum Backend {SCALAR, SSE2, AVX2};
+    static inline const std::string backend_names[3] = {"Scalar", "SSE2", "AVX2"};
+
+    uint32_t seed;
+    Backend backend;
+
+    Noise(uint32_t seed, Backend backend = best_backend()){
+        this->seed = seed;
+        this->backend = supported(backend) ? backend : SCALAR;
+    }
+
+    static bool supported(Backend backend){ // Whether the CPU can run this backend
+        if (backend == SCALAR) return true;
+#ifdef NOISE_SIMD
+        __builtin_cpu_init();
+        if (backend == SSE2) return __builtin_cpu_supports("sse2");
+        if (backend == AVX2) return __builtin_cpu_supports("avx2");
+#endif
+        return false;
+    }
+
+    static Backend best_backend(){
+        if (supported(AVX2)) return AVX2;
+        if (supported(SSE2)) return SSE2;
+        return SCALAR;
+    }
+
+    // Noise is 0 at integer coordinates, and mostly between -1 and 1
+    float noise2(float x, float y, uint32_t seed) const {
+        int ix = floor_int(x), iy = floor_int(y);
+        float fx = x - (float)ix, fy = y - (float)iy;
+        float u = fade(fx), v = fade(fy);
+        float n00 = grad2(hash2(ix, iy, seed), fx, fy);
+        float n10 = grad2(hash2(ix+1, iy, seed), fx - 1.0f, fy);
+        float n01 = grad2(hash2(ix, iy+1, seed), fx, fy - 1.0f);
+        float n11 = grad2(hash2(ix+1, iy+1, seed), fx - 1.0f, fy - 1.0f);
+        return scale_2D * lerp(v, lerp(u, n00, n10), lerp(u, n01, n11));
+    }
+
+    float noise3(float x, float y, float z, uint32_t seed) const {
+        int ix = floor_int(x), iy = floor_int(y), iz = floor_int(z);
+        float fx = x - (float)ix, fy = y - (float)iy, fz = z - (float)iz;
+        float u = fade(fx), v = fade(fy), w = fade(fz);
+        float n000 = grad3(hash3(ix, iy, iz, seed), fx, fy, fz);
+        float n100 = grad3(hash3(ix+1, iy, iz, seed), fx - 1.0f, fy, fz);
+        float n010 = grad3(hash3(ix, iy+1, iz, seed), fx, fy - 1.0f, fz);
+        float n110 = grad3(hash3(ix+1, iy+1, iz, seed), fx - 1.0f, fy - 1.0f, fz);
+        float n001 = grad3(hash3(ix, iy, iz+1, seed), fx, fy, fz - 1.0f);
+        float n101 = grad3(hash3(ix+1, iy, iz+1, seed), fx - 1.0f, fy, fz - 1.0f);
+        float n011 = grad3(hash3(ix, iy+1, iz+1, seed), fx, fy - 1.0f, fz - 1.0f);
+        float n111 = grad3(hash3(ix+1, iy+1, iz+1, seed), fx - 1.0f, fy - 1.0f, fz - 1.0f);
+        float nx00 = lerp(u, n000, n100), nx10 = lerp(u, n010, n110), nx01 = lerp(u, n001, n101), nx11 = lerp(u, n011, n111);
+        return scale_3D * lerp(w, lerp(v, nx00, nx10), lerp(v, nx01, nx11));
+    }
+
+    float fbm2(float x, float y, Fbm fbm) const { // Octave o uses the seed plus o
+        float sum = 0.0f, frequency = fbm.frequency, amplitude = 1.0f;
+        for (int octave = 0; octave < fbm.octaves; octave++){
+            sum = sum + amplitude * noise2(x*frequency, y*frequency, seed + octave);
+            frequency *= fbm.lacunarity;
+            amplitude *= fbm.gain;
+        }
+        return sum;
+    }
+
+    float fbm3(float x, float y, float z, Fbm fbm) const {
+        float sum = 0.0f, frequency = fbm.frequency, amplitude = 1.0f;
+        for (int octave = 0; octave < fbm.octaves; octave++){
+            sum = sum + amplitude * noise3(x*frequency, y*frequency, z*frequency, seed + octave);
+            frequency *= fbm.lacunarity;
+            amplitude *= fbm.gain;
+        }
+        return sum;
+    }
+
+    void fbm2_grid(int x0, int y0, int width, int height, Fbm fbm, float* out) const { // out[i + width*j] = fbm2(x0+i, y0+j), e.g. the heightmap of a chunk
+        for (int j = 0; j < height; j++){
+            int i = 0;
+#ifdef NOISE_SIMD
+            if (backend == AVX2) i = fbm2_row_avx2(x0, y0 + j, width, fbm, out + width*j);
+            else if (backend == SSE2) i = fbm2_row_sse2(x0, y0 + j, width, fbm, out + width*j);
+#endif
+            for (; i < width; i++) out[i + width*j] = fbm2((float)(x0 + i), (float)(y0 + j), fbm); // Rest of the row that doesn't fill a whole register
+        }
+    }
+
+    void fbm3_grid(int x0, int y0, int z0, int width, int height, int depth, Fbm fbm, float* out) const { // out[i + width*(k + depth*j)] = fbm3(x0+i, y0+j, z0+k), x varying fastest then z then y like in Chunk
+        for (int j = 0; j < height; j++){
+            for (int k = 0; k < depth; k++){
+                float* row = out + width*(k + depth*j);
+                int i = 0;
+#ifdef NOISE_SIMD
+                if (backend == AVX2) i = fbm3_row_avx2(x0, y0 + j, z0 + k, width, fbm, row);
+                else if (backend == SSE2) i = fbm3_row_sse2(x0, y0 + j, z0 + k, width, fbm, row);
+#endif
+                for (; i < width; i++) row[i] = fbm3((float)(x0 + i), (float)(y0 + j), (float)(z0 + k), fbm);
+            }
+        }
+    }
+
+    static void benchmark(){ // Prints the speed of each backend for chunk heightmaps and density fields (Tests.cpp checks that they give the same values)
+        const int size = 16, num_chunks = 2000;
+        Fbm fbm;
+        fbm.frequency = 1.0f/64;
+        std::vector<float> values_2D(size*size), values_3D(size*size*size);
+        for (int backend = SCALAR; backend <= AVX2; backend++){
+            if (!supported((Backend)backend)){
+                std::cout << backend_names[backend] << ": not supported by this CPU" << std::endl;
+                continue;
+            }
+            Noise noise(1234, (Backend)backend);
+            auto start = std::chrono::steady_clock::now();
+            for (int chunk = 0; chunk < num_chunks; chunk++) noise.fbm2_grid(chunk*size, -chunk*size, size, size, fbm, &values_2D[0]);
+            double time_2D = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            start = std::chrono::steady_clock::now();
+            for (int chunk = 0; chunk < num_chunks/size; chunk++) noise.fbm3_grid(chunk*size, -chunk*size, chunk*size, size, size, size, fbm, &values_3D[0]);
+            double time_3D = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::cout << backend_names[backend] << ": " << (long long)(num_chunks*size*size/time_2D) << " heightmap columns per second, "
+                      << (long long)(num_chunks/size*size*size*size/time_3D) << " density cells per second (" << fbm.octaves << " octaves)" << std::endl;
+        }
+    }
+
+private:
+    static inline const float scale_2D = 0.66f; // Brings the noise back to about [-1, 1]
+    static inline const float scale_3D = 1.0f;
+    static inline const uint32_t prime_x = 0x8da6b343u, prime_y = 0xd8163841u, prime_z = 0xcb1ab31fu, prime_mix = 0x27d4eb2du;
+
+    static int floor_int(float x){ // Same as (int)floor(x), written like the SIMD versions
+        int i = (int)x; // Rounded towards 0
+        return x < (float)i ? i - 1 : i;
+    }
+
+    static float fade(float t){ // 6t^5 - 15t^4 + 10t^3
+        return t*t*t*(t*(t*6.0f - 15.0f) + 10.0f);
+    }
+
+    static float lerp(float t, float a, float b){
+        return a + t*(b - a);
+    }
+
+    static uint32_t hash2(int x, int y, uint32_t seed){ // Random bits for a lattice point
+        uint32_t h = ((uint32_t)x*prime_x) ^ ((uint32_t)y*prime_y) ^ seed;
+        h *= prime_mix;
+        return h ^ (h >> 15);
+    }
+
+    static uint32_t hash3(int x, int y, int z, uint32_t seed){
+        uint32_t h = ((uint32_t)x*prime_x) ^ ((uint32_t)y*prime_y) ^ ((uint32_t)z*prime_z) ^ seed;
+        h *= prime_mix;
+        return h ^ (h >> 15);
+    }
+
+    static float grad2(uint32_t h, float x, float y){ // Dot product with one of the 8 gradients (+-1, +-2) and (+-2, +-1)
+        float u = (h & 4) ? y : x;
+        float v = (h & 4) ? x : y;
+        return ((h & 1) ? -u : u) + ((h & 2) ? -(v + v) : v + v);
+    }
+
+    static float grad3(uint32_t h, float x, float y, float z){ // Dot product with one of the 12 gradients towards the edges of a cube (Perlin's improved noise)
+        int h15 = h & 15;
+        float u = h15 < 8 ? x : y;
+        float v = h15 < 4 ? y : (h15 == 12 || h15 == 14) ? x : z;
+        return ((h & 1) ? -u : u) + ((h & 2) ? -v : v);
+    }
+
+#ifdef NOISE_SIMD
+    // SSE2: 4 values at once. SSE2 has no 32-bit multiplication, so it is done with two 32x32->64 multiplications
+    __attribute__((target("sse2"))) static __m128i mullo_sse2(__m128i a, __m128i b){
+        __m128i even = _mm_mul_epu32(a, b);
+        __m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+        return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+    }
+
+    __attribute__((target("sse2"))) static __m128 select_sse2(__m128i mask, __m128 a, __m128 b){ // a where mask is set, b elsewhere
+        __m128 m = _mm_castsi128_ps(mask);
+        return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+    }
+
+    __attribute__((target("sse2"))) static __m128 flip_sse2(__m128 x, __m128i h, int bit){ // -x where bit of h is set
+        __m128i sign = _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(1 << bit)), 31 - bit);
+        return _mm_xor_ps(x, _mm_castsi128_ps(sign));
+    }
+
+    __attribute__((target("sse2"))) static __m128i floor_sse2(__m128 x){
+        __m128i i = _mm_cvttps_epi32(x);
+        return _mm_add_epi32(i, _mm_castps_si128(_mm_cmplt_ps(x, _mm_cvtepi32_ps(i)))); // The mask is -1 where x < i
+    }
+
+    __attribute__((target("sse2"))) static __m128 fade_sse2(__m128 t){
+        __m128 t3 = _mm_mul_ps(_mm_mul_ps(t, t), t);
+        __m128 inner = _mm_add_ps(_mm_mul_ps(t, _mm_sub_ps(_mm_mul_ps(t, _mm_set1_ps(6.0f)), _mm_set1_ps(15.0f))), _mm_set1_ps(10.0f));
+        return _mm_mul_ps(t3, inner);
+    }
+
+    __attribute__((target("sse2"))) static __m128 lerp_sse2(__m128 t, __m128 a, __m128 b){
+        return _mm_add_ps(a, _mm_mul_ps(t, _mm_sub_ps(b, a)));
+    }
+
+    __attribute__((target("sse2"))) static __m128i hash_sse2(__m128i hx, __m128i hy, __m128i hz, uint32_t seed){ // hx, hy and hz are already multiplied by their prime
+        __m128i h = _mm_xor_si128(_mm_xor_si128(_mm_xor_si128(hx, hy), hz), _mm_set1_epi32(seed));
+        h = mullo_sse2(h, _mm_set1_epi32(prime_mix));
+        return _mm_xor_si128(h, _mm_srli_epi32(h, 15));
+    }
+
+    __attribute__((target("sse2"))) static __m128 grad2_sse2(__m128i h, __m128 x, __m128 y){
+        __m128i swap = _mm_cmpeq_epi32(_mm_and_si128(h, _mm_set1_epi32(4)), _mm_set1_epi32(4));
+        __m128 u = select_sse2(swap, y, x), v = select_sse2(swap, x, y);
+        return _mm_add_ps(flip_sse2(u, h, 0), flip_sse2(_mm_add_ps(v, v), h, 1));
+    }
+
+    __attribute__((target("sse2"))) static __m128 grad3_sse2(__m128i h, __m128 x, __m128 y, __m128 z){
+        __m128i h15 = _mm_and_si128(h, _mm_set1_epi32(15));
+        __m128i x_or_z = _mm_or_si128(_mm_cmpeq_epi32(h15, _mm_set1_epi32(12)), _mm_cmpeq_epi32(h15, _mm_set1_epi32(14)));
+        __m128 u = select_sse2(_mm_cmplt_epi32(h15, _mm_set1_epi32(8)), x, y);
+        __m128 v = select_sse2(_mm_cmplt_epi32(h15, _mm_set1_epi32(4)), y, select_sse2(x_or_z, x, z));
+        return _mm_add_ps(flip_sse2(u, h, 0), flip_sse2(v, h, 1));
+    }
+
+    __attribute__((target("sse2"))) static __m128 noise2_sse2(__m128 x, __m128 y, uint32_t seed){
+        __m128i one = _mm_set1_epi32(1);
+        __m128i ix = floor_sse2(x), iy = floor_sse2(y);
+        __m128 fx = _mm_sub_ps(x, _mm_cvtepi32_ps(ix)), fy = _mm_sub_ps(y, _mm_cvtepi32_ps(iy));
+        __m128 fx1 = _mm_sub_ps(fx, _mm_set1_ps(1.0f)), fy1 = _mm_sub_ps(fy, _mm_set1_ps(1.0f));
+        __m128 u = fade_sse2(fx), v = fade_sse2(fy);
+        __m128i hx0 = mullo_sse2(ix, _mm_set1_epi32(prime_x)), hx1 = mullo_sse2(_mm_add_epi32(ix, one), _mm_set1_epi32(prime_x));
+        __m128i hy0 = mullo_sse2(iy, _mm_set1_epi32(prime_y)), hy1 = mullo_sse2(_mm_add_epi32(iy, one), _mm_set1_epi32(prime_y));
+        __m128i zero = _mm_setzero_si128();
+        __m128 n00 = grad2_sse2(hash_sse2(hx0, hy0, zero, seed), fx, fy);
+        __m128 n10 = grad2_sse2(hash_sse2(hx1, hy0, zero, seed), fx1, fy);
+        __m128 n01 = grad2_sse2(hash_sse2(hx0, hy1, zero, seed), fx, fy1);
+        __m128 n11 = grad2_sse2(hash_sse2(hx1, hy1, zero, seed), fx1, fy1);
+        return _mm_mul_ps(_mm_set1_ps(scale_2D), lerp_sse2(v, lerp_sse2(u, n00, n10), lerp_sse2(u, n01, n11)));
+    }
+
+    __attribute__((target("sse2"))) static __m128 noise3_sse2(__m128 x, __m128 y, __m128 z, uint32_t seed){
+        __m128i one = _mm_set1_epi32(1);
+        __m128i ix = floor_sse2(x), iy = floor_sse2(y), iz = floor_sse2(z);
+        __m128 fx = _mm_sub_ps(x, _mm_cvtepi32_ps(ix)), fy = _mm_sub_ps(y, _mm_cvtepi32_ps(iy)), fz = _mm_sub_ps(z, _mm_cvtepi32_ps(iz));
+        __m128 fx1 = _mm_sub_ps(fx, _mm_set1_ps(1.0f)), fy1 = _mm_sub_ps(fy, _mm_set1_ps(1.0f)), fz1 = _mm_sub_ps(fz, _mm_set1_ps(1.0f));
+        __m128 u = fade_sse2(fx), v = fade_sse2(fy), w = fade_sse2(fz);
+        __m128i hx0 = mullo_sse2(ix, _mm_set1_epi32(prime_x)), hx1 = mullo_sse2(_mm_add_epi32(ix, one), _mm_set1_epi32(prime_x));
+        __m128i hy0 = mullo_sse2(iy, _mm_set1_epi32(prime_y)), hy1 = mullo_sse2(_mm_add_epi32(iy, one), _mm_set1_epi32(prime_y));
+        __m128i hz0 = mullo_sse2(iz, _mm_set1_epi32(prime_z)), hz1 = mullo_sse2(_mm_add_epi32(iz, one), _mm_set1_epi32(prime_z));
+        __m128 n000 = grad3_sse2(hash_sse2(hx0, hy0, hz0, seed), fx, fy, fz);
+        __m128 n100 = grad3_sse2(hash_sse2(hx1, hy0, hz0, seed), fx1, fy, fz);
+        __m128 n010 = grad3_sse2(hash_sse2(hx0, hy1, hz0, seed), fx, fy1, fz);
+        __m128 n110 = grad3_sse2(hash_sse2(hx1, hy1, hz0, seed), fx1, fy1, fz);
+        __m128 n001 = grad3_sse2(hash_sse2(hx0, hy0, hz1, seed), fx, fy, fz1);
+        __m128 n101 = grad3_sse2(hash_sse2(hx1, hy0, hz1, seed), fx1, fy, fz1);
+        __m128 n011 = grad3_sse2(hash_sse2(hx0, hy1, hz1, seed), fx, fy1, fz1);
+        __m128 n111 = grad3_sse2(hash_sse2(hx1, hy1, hz1, seed), fx1, fy1, fz1);
+        __m128 nx00 = lerp_sse2(u, n000, n100), nx10 = lerp_sse2(u, n010, n110), nx01 = lerp_sse2(u, n001, n101), nx11 = lerp_sse2(u, n011, n111);
+        return _mm_mul_ps(_mm_set1_ps(scale_3D), lerp_sse2(w, lerp_sse2(v, nx00, nx10), lerp_sse2(v, nx01, nx11)));
+    }
+
+    __attribute__((target("sse2"))) int fbm2_row_sse2(int x0, int y, int width, Fbm fbm, float* out) const { // Fills out[i] = fbm2(x0+i, y) 4 values at a time, returns the number of values filled
+        int i = 0;
+        for (; i + 4 <= width; i += 4){
+            __m128 x = _mm_cvtepi32_ps(_mm_add_epi32(_mm_set1_epi32(x0 + i), _mm_setr_epi32(0, 1, 2, 3)));
+            __m128 y_lanes = _mm_set1_ps((float)y);
+            __m128 sum = _mm_setzero_ps();
+            float frequency = fbm.frequency, amplitude = 1.0f;
+            for (int octave = 0; octave < fbm.octaves; octave++){
+                __m128 f = _mm_set1_ps(frequency);
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(amplitude), noise2_sse2(_mm_mul_ps(x, f), _mm_mul_ps(y_lanes, f), seed + octave)));
+                frequency *= fbm.lacunarity;
+                amplitude *= fbm.gain;
+            }
+            _mm_storeu_ps(out + i, sum);
+        }
+        return i;
+    }
+
+    __attribute__((target("sse2"))) int fbm3_row_sse2(int x0, int y, int z, int width, Fbm fbm, float* out) const {
+        int i = 0;
+        for (; i + 4 <= width; i += 4){
+            __m128 x = _mm_cvtepi32_ps(_mm_add_epi32(_mm_set1_epi32(x0 + i), _mm_setr_epi32(0, 1, 2, 3)));
+            __m128 y_lanes = _mm_set1_ps((float)y), z_lanes = _mm_set1_ps((float)z);
+            __m128 sum = _mm_setzero_ps();
+            float frequency = fbm.frequency, amplitude = 1.0f;
+            for (int octave = 0; octave < fbm.octaves; octave++){
+                __m128 f = _mm_set1_ps(frequency);
+                sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(amplitude), noise3_sse2(_mm_mul_ps(x, f), _mm_mul_ps(y_lanes, f), _mm_mul_ps(z_lanes, f), seed + octave)));
+                frequency *= fbm.lacunarity;
+                amplitude *= fbm.gain;
+            }
+            _mm_storeu_ps(out + i, sum);
+        }
+        return i;
+    }
+
+    // AVX2: same as SSE2 with 8 values at once
+    __attribute__((target("avx2"))) static __m256 select_avx2(__m256i mask, __m256 a, __m256 b){
+        return _mm256_blendv_ps(b, a, _mm256_castsi256_ps(mask));
+    }
+
+    __attribute__((target("avx2"))) static __m256 flip_avx2(__m256 x, __m256i h, int bit){
+        __m256i sign = _mm256_slli_epi32(_mm256_and_si256(h, _mm256_set1_epi32(1 << bit)), 31 - bit);
+        return _mm256_xor_ps(x, _mm256_castsi256_ps(sign));
+    }
+
+    __attribute__((target("avx2"))) static __m256i floor_avx2(__m256 x){
+        __m256i i = _mm256_cvttps_epi32(x);
+        return _mm256_add_epi32(i, _mm256_castps_si256(_mm256_cmp_ps(x, _mm256_cvtepi32_ps(i), _CMP_LT_OQ)));
+    }
+
+    __attribute__((target("avx2"))) static __m256 fade_avx2(__m256 t){
+        __m256 t3 = _mm256_mul_ps(_mm256_mul_ps(t, t), t);
+        __m256 inner = _mm256_add_ps(_mm256_mul_ps(t, _mm256_sub_ps(_mm256_mul_ps(t, _mm256_set1_ps(6.0f)), _mm256_set1_ps(15.0f))), _mm256_set1_ps(10.0f));
+        return _mm256_mul_ps(t3, inner);
+    }
+
+    __attribute__((target("avx2"))) static __m256 lerp_avx2(__m256 t, __m256 a, __m256 b){
+        return _mm256_add_ps(a, _mm256_mul_ps(t, _mm256_sub_ps(b, a)));
+    }
+
+    __attribute__((target("avx2"))) static __m256i hash_avx2(__m256i hx, __m256i hy, __m256i hz, uint32_t seed){
+        __m256i h = _mm256_xor_si256(_mm256_xor_si256(_mm256_xor_si256(hx, hy), hz), _mm256_set1_epi32(seed));
+        h = _mm256_mullo_epi32(h, _mm256_set1_epi32(prime_mix));
+        return _mm256_xor_si256(h, _mm256_srli_epi32(h, 15));
+    }
+
+    __attribute__((target("avx2"))) static __m256 grad2_avx2(__m256i h, __m256 x, __m256 y){
+        __m256i swap = _mm256_cmpeq_epi32(_mm256_and_si256(h, _mm256_set1_epi32(4)), _mm256_set1_epi32(4));
+        __m256 u = select_avx2(swap, y, x), v = select_avx2(swap, x, y);
+        return _mm256_add_ps(flip_avx2(u, h, 0), flip_avx2(_mm256_add_ps(v, v), h, 1));
+    }
+
+    __attribute__((target("avx2"))) static __m256 grad3_avx2(__m256i h, __m256 x, __m256 y, __m256 z){
+        __m256i h15 = _mm256_and_si256(h, _mm256_set1_epi32(15));
+        __m256i x_or_z = _mm256_or_si256(_mm256_cmpeq_epi32(h15, _mm256_set1_epi32(12)), _mm256_cmpeq_epi32(h15, _mm256_set1_epi32(14)));
+        __m256 u = select_avx2(_mm256_cmpgt_epi32(_mm256_set1_epi32(8), h15), x, y);
+        __m256 v = select_avx2(_mm256_cmpgt_epi32(_mm256_set1_epi32(4), h15), y, select_avx2(x_or_z, x, z));
+        return _mm256_add_ps(flip_avx2(u, h, 0), flip_avx2(v, h, 1));
+    }
+
+    __attribute__((target("avx2"))) static __m256 noise2_avx2(__m256 x, __m256 y, uint32_t seed){
+        __m256i one = _mm256_set1_epi32(1);
+        __m256i ix = floor_avx2(x), iy = floor_avx2(y);
+        __m256 fx = _mm256_sub_ps(x, _mm256_cvtepi32_ps(ix)), fy = _mm256_sub_ps(y, _mm256_cvtepi32_ps(iy));
+        __m256 fx1 = _mm256_sub_ps(fx, _mm256_set1_ps(1.0f)), fy1 = _mm256_sub_ps(fy, _mm256_set1_ps(1.0f));
+        __m256 u = fade_avx2(fx), v = fade_avx2(fy);
+        __m256i hx0 = _mm256_mullo_epi32(ix, _mm256_set1_epi32(prime_x)), hx1 = _mm256_mullo_epi32(_mm256_add_epi32(ix, one), _mm256_set1_epi32(prime_x));
+        __m256i hy0 = _mm256_mullo_epi32(iy, _mm256_set1_epi32(prime_y)), hy1 = _mm256_mullo_epi32(_mm256_add_epi32(iy, one), _mm256_set1_epi32(prime_y));
+        __m256i zero = _mm256_setzero_si256();
+        __m256 n00 = grad2_avx2(hash_avx2(hx0, hy0, zero, seed), fx, fy);
+        __m256 n10 = grad2_avx2(hash_avx2(hx1, hy0, zero, seed), fx1, fy);
+        __m256 n01 = grad2_avx2(hash_avx2(hx0, hy1, zero, seed), fx, fy1);
+        __m256 n11 = grad2_avx2(hash_avx2(hx1, hy1, zero, seed), fx1, fy1);
+        return _mm256_mul_ps(_mm256_set1_ps(scale_2D), lerp_avx2(v, lerp_avx2(u, n00, n10), lerp_avx2(u, n01, n11)));
+    }
+
+    __attribute__((target("avx2"))) static __m256 noise3_avx2(__m256 x, __m256 y, __m256 z, uint32_t seed){
+        __m256i one = _mm256_set1_epi32(1);
+        __m256i ix = floor_avx2(x), iy = floor_avx2(y), iz = floor_avx2(z);
+        __m256 fx = _mm256_sub_ps(x, _mm256_cvtepi32_ps(ix)), fy = _mm256_sub_ps(y, _mm256_cvtepi32_ps(iy)), fz = _mm256_sub_ps(z, _mm256_cvtepi32_ps(iz));
+        __m256 fx1 = _mm256_sub_ps(fx, _mm256_set1_ps(1.0f)), fy1 = _mm256_sub_ps(fy, _mm256_set1_ps(1.0f)), fz1 = _mm256_sub_ps(fz, _mm256_set1_ps(1.0f));
+        __m256 u = fade_avx2(fx), v = fade_avx2(fy), w = fade_avx2(fz);
+        __m256i hx0 = _mm256_mullo_epi32(ix, _mm256_set1_epi32(prime_x)), hx1 = _mm256_mullo_epi32(_mm256_add_epi32(ix, one), _mm256_set1_epi32(prime_x));
+        __m256i hy0 = _mm256_mullo_epi32(iy, _mm256_set1_epi32(prime_y)), hy1 = _mm256_mullo_epi32(_mm256_add_epi32(iy, one), _mm256_set1_epi32(prime_y));
+        __m256i hz0 = _mm256_mullo_epi32(iz, _mm256_set1_epi32(prime_z)), hz1 = _mm256_mullo_epi32(_mm256_add_epi32(iz, one), _mm256_set1_epi32(prime_z));
+        __m256 n000 = grad3_avx2(hash_avx2(hx0, hy0, hz0, seed), fx, fy, fz);
+        __m256 n100 = grad3_avx2(hash_avx2(hx1, hy0, hz0, seed), fx1, fy, fz);
+        __m256 n010 = grad3_avx2(hash_avx2(hx0, hy1, hz0, seed), fx, fy1, fz);
+        __m256 n110 = grad3_avx2(hash_avx2(hx1, hy1, hz0, seed), fx1, fy1, fz);
+        __m256 n001 = grad3_avx2(hash_avx2(hx0, hy0, hz1, seed), fx, fy, fz1);
+        __m256 n101 = grad3_avx2(hash_avx2(hx1, hy0, hz1, seed), fx1, fy, fz1);
+        __m256 n011 = grad3_avx2(hash_avx2(hx0, hy1, hz1, seed), fx, fy1, fz1);
+        __m256 n111 = grad3_avx2(hash_avx2(hx1, hy1, hz1, seed), fx1, fy1, fz1);
+        __m256 nx00 = lerp_avx2(u, n000, n100), nx10 = lerp_avx2(u, n010, n110), nx01 = lerp_avx2(u, n001, n101), nx11 = lerp_avx2(u, n011, n111);
+        return _mm256_mul_ps(_mm256_set1_ps(scale_3D), lerp_avx2(w, lerp_avx2(v, nx00, nx10), lerp_avx2(v, nx01, nx11)));
+    }
+
+    __attribute__((target("avx2"))) int fbm2_row_avx2(int x0, int y, int width, Fbm fbm, float* out) const {
+        int i = 0;
+        for (; i + 8 <= width; i += 8){
+            __m256 x = _mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_set1_epi32(x0 + i), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)));
+            __m256 y_lanes = _mm256_set1_ps((float)y);
+            __m256 sum = _mm256_setzero_ps();
+            float frequency = fbm.frequency, amplitude = 1.0f;
+            for (int octave = 0; octave < fbm.octaves; octave++){
+                __m256 f = _mm256_set1_ps(frequency);
+                sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(amplitude), noise2_avx2(_mm256_mul_ps(x, f), _mm256_mul_ps(y_lanes, f), seed + octave)));
+                frequency *= fbm.lacunarity;
+                amplitude *= fbm.gain;
+            }
+            _mm256_storeu_ps(out + i, sum);
+        }
+        return i;
+    }
+
+    __attribute__((target("avx2"))) int fbm3_row_avx2(int x0, int y, int z, int width, Fbm fbm, float* out) const {
+        int i = 0;
+        for (; i + 8 <= width; i += 8){
+            __m256 x = _mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_set1_epi32(x0 + i), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7)));
+            __m256 y_lanes = _mm256_set1_ps((float)y), z_lanes = _mm256_set1_ps((float)z);
+            __m256 sum = _mm256_setzero_ps();
+            float frequency = fbm.frequency, amplitude = 1.0f;
+            for (int octave = 0; octave < fbm.octaves; octave++){
+                __m256 f = _mm256_set1_ps(frequency);
+                sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_set1_ps(amplitude), noise3_avx2(_mm256_mul_ps(x, f), _mm256_mul_ps(y_lanes, f), _mm256_mul_ps(z_lanes, f), seed + octave)));
+                frequency *= fbm.lacunarity;
+                amplitude *= fbm.gain;
+            }
+            _mm256_storeu_ps(out + i, sum);
+        }
+        return i;
+    }
+#endif
+};
+#endif
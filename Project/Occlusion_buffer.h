@@ -0,0 +1,215 @@
+#ifndef OCCLUSION_BUFFER_H
+#define OCCLUSION_BUFFER_H
+
+#include <iostream>
+#include <vector>
+#include <array>
+#include <algorithm>
+#include <limits>
+#include <cmath>
+#include <chrono>
+#include <bitset>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include "Chunk.h"
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define OCCLUSION_SSE
+#include <xmmintrin.h>
+#endif
+
+struct Occluder_box{ // Box made only of opaque blocks, in world coordinates
+    glm::vec3 min, max;
+};
+
+class Occlusion_buffer{ // Low resolution depth buffer filled on the CPU with the boxes of nearby opaque blocks, to skip the chunks hidden behind them
+    // Occluders are faces of boxes of opaque blocks, written in the pixels whose center they cover with the farthest depth of the face, so that adjacent faces
+    // leave no hole. A box is hidden if all the pixels it touches and their neighbours are nearer than its nearest corner: the neighbours cover the parts of the
+    // pixels on the edges of occluders that are not behind them. Only gaps between occluders thinner than a pixel are considered closed
+    // Depths are view depths (w in clip coordinates), so it works with perspective projections
+public:
+    static inline const int width = 256, height = 128;
+    long long pixels_written = 0; // Statistics since they were last reset
+
+    Occlusion_buffer(): depths(width*height){
+    }
+
+    void clear(glm::mat4 view_projection, glm::vec3 camera_pos){ // Empties the buffer for a new view
+        this->view_projection = view_projection;
+        this->camera_pos = camera_pos;
+        std::fill(depths.begin(), depths.end(), std::numeric_limits<float>::infinity());
+    }
+
+    void add_occluder(const Occluder_box &box){ // Draws the faces of the box that face the camera
+        for (int axis = 0; axis < 3; axis++){
+            for (int side = 0; side < 2; side++){
+                float plane = side == 0 ? box.min[axis] : box.max[axis];
+                if (side == 0 ? camera_pos[axis] >= plane : camera_pos[axis] <= plane) continue; // Back face, hidden by the front faces
+                int u = (axis + 1) % 3, v = (axis + 2) % 3;
+                glm::vec3 corners[4];
+                for (int i = 0; i < 4; i++){ // In order around the face
+                    corners[i][axis] = plane;
+                    corners[i][u] = (i == 1 || i == 2) ? box.max[u] : box.min[u];
+                    corners[i][v] = i >= 2 ? box.max[v] : box.min[v];
+                }
+                draw_quad(corners);
+            }
+        }
+    }
+
+    bool visible(glm::vec3 min, glm::vec3 max) const { // Whether some part of box [min, max] may be in front of the occluders
+        float min_x = width, min_y = height, max_x = 0.0f, max_y = 0.0f, nearest = std::numeric_limits<float>::infinity();
+        for (int i = 0; i < 8; i++){
+            glm::vec3 corner((i & 1) ? max.x : min.x, (i & 2) ? max.y : min.y, (i & 4) ? max.z : min.z);
+            glm::vec3 screen;
+            if (!project(corner, screen)) return true; // Behind or too close to the camera
+            min_x = std::min(min_x, screen.x);
+            max_x = std::max(max_x, screen.x);
+            min_y = std::min(min_y, screen.y);
+            max_y = std::max(max_y, screen.y);
+            nearest = std::min(nearest, screen.z);
+        }
+        if (max_x <= 0.0f || min_x >= width || max_y <= 0.0f || min_y >= height) return false; // Out of the screen
+        int x0 = std::max(0, (int)std::floor(min_x) - 1), x1 = std::min(width-1, (int)std::ceil(max_x)); // The pixels the box touches and their neighbours
+        int y0 = std::max(0, (int)std::floor(min_y) - 1), y1 = std::min(height-1, (int)std::ceil(max_y));
+        for (int y = y0; y <= y1; y++){
+            const float* row = &depths[y*width];
+            int x = x0;
+#ifdef OCCLUSION_SSE
+            __m128 nearest_4 = _mm_set1_ps(nearest);
+            for (; x + 4 <= x1 + 1; x += 4) if (_mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(row + x), nearest_4)) != 0) return true;
+#endif
+            for (; x <= x1; x++) if (row[x] >= nearest) return true;
+        }
+        return false;
+    }
+
+    static void add_chunk_occluders(const Chunk &chunk, const std::array<bool, 256> &opaque, std::vector<Occluder_box> &boxes){
+        // Appends boxes of opaque blocks of the chunk: for each cell of 4 x 4 columns, the blocks from the bottom of the chunk up to the lowest non-opaque block of the cell
+        const int cell = 4, size = Chunk::size;
+        for (int cell_z = 0; cell_z < size; cell_z += cell){
+            for (int cell_x = 0; cell_x < size; cell_x += cell){
+                int solid_height = size;
+                for (int z = cell_z; z < cell_z + cell && solid_height > 0; z++){
+                    for (int x = cell_x; x < cell_x + cell && solid_height > 0; x++){
+                        int y = 0;
+                        while (y < solid_height && opaque[chunk.get(x, y, z)]) y++;
+                        solid_height = y;
+                    }
+                }
+                if (solid_height == 0) continue;
+                glm::vec3 origin = glm::vec3(chunk.chunk_x, chunk.chunk_y, chunk.chunk_z) * (float)size - 0.5f; // Blocks are centered on integer coordinates
+                boxes.push_back({origin + glm::vec3(cell_x, 0, cell_z), origin + glm::vec3(cell_x + cell, solid_height, cell_z + cell)});
+            }
+        }
+    }
+
+    static void benchmark(){ // Prints the time to draw the occluders of a wall covering the view and to test the chunks around it (whose results are checked by the tests)
+        glm::vec3 camera_pos(0.0f, 5.0f, 0.0f);
+        glm::mat4 view_projection = glm::perspective(glm::radians(45.0f), 16.0f/9.0f, 0.1f, 100.0f) * glm::lookAt(camera_pos, glm::vec3(0.0f, 5.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        Occlusion_buffer buffer;
+        std::vector<Occluder_box> occluders;
+        for (int i = -8; i < 8; i++) occluders.push_back({glm::vec3(4*i, -20, -12), glm::vec3(4*i + 4, 40, -10)}); // Wall of 16 boxes 10 blocks in front of the camera
+        int num_hidden = 0, num_tested = 0;
+        const int num_repeats = 1000;
+        auto start = std::chrono::steady_clock::now();
+        for (int repeat = 0; repeat < num_repeats; repeat++){
+            buffer.clear(view_projection, camera_pos);
+            for (const Occluder_box &box: occluders) buffer.add_occluder(box);
+        }
+        double draw_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()/num_repeats;
+        start = std::chrono::steady_clock::now();
+        for (int repeat = 0; repeat < num_repeats; repeat++){
+            for (int x = -40; x < 40; x += 16){
+                for (int z = -80; z < 0; z += 16){
+                    for (int y = 0; y < 32; y += 16){
+                        glm::vec3 min(x, y, z), max(x + 16, y + 16, z + 16);
+                        bool visible = buffer.visible(min, max);
+                        if (repeat > 0) continue;
+                        num_tested++;
+                        num_hidden += !visible;
+                    }
+                }
+            }
+        }
+        double test_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()/num_repeats;
+        std::cout << "Occlusion buffer " << width << "x" << height << ": " << occluders.size() << " occluders drawn in " << 1000*draw_time << " ms, " << num_tested << " chunks tested in "
+                  << 1000*test_time << " ms, " << num_hidden << " hidden" << std::endl;
+    }
+
+private:
+    glm::mat4 view_projection;
+    glm::vec3 camera_pos;
+    std::vector<float> depths; // View depth of the nearest occluder of each pixel, row by row, infinity if none
+    static inline const float min_depth = 0.05f; // Points nearer to the camera plane are not projected
+
+    bool project(glm::vec3 point, glm::vec3 &screen) const { // Pixel coordinates (x, y) and view depth (z) of a point, false if it is behind or too close to the camera
+        glm::vec4 clip = view_projection * glm::vec4(point, 1.0f);
+        if (clip.w < min_depth) return false;
+        screen = glm::vec3((clip.x/clip.w*0.5f + 0.5f)*width, (clip.y/clip.w*0.5f + 0.5f)*height, clip.w);
+        return true;
+    }
+
+    void draw_quad(const glm::vec3 corners[4]){ // Writes the farthest depth of the quad in the pixels whose center it covers, so that the written depths are never nearer than the quad
+        glm::vec2 points[4];
+        float farthest = 0.0f;
+        for (int i = 0; i < 4; i++){
+            glm::vec3 screen;
+            if (!project(corners[i], screen)) return; // Crosses the camera plane, skipped (which is conservative)
+            points[i] = glm::vec2(screen);
+            farthest = std::max(farthest, screen.z);
+        }
+        float area = 0.0f;
+        for (int i = 0; i < 4; i++) area += points[i].x*points[(i+1)%4].y - points[(i+1)%4].x*points[i].y;
+        if (std::abs(area) < 1e-6f) return;
+        if (area < 0) std::swap(points[1], points[3]); // Counter-clockwise, so that the inside is on the left of each edge
+
+        float a[4], b[4], c[4]; // Edge i is a*x + b*y + c >= 0 inside
+        for (int i = 0; i < 4; i++){
+            glm::vec2 p = points[i], q = points[(i+1)%4];
+            a[i] = p.y - q.y;
+            b[i] = q.x - p.x;
+            c[i] = -(a[i]*p.x + b[i]*p.y);
+        }
+        float min_x = std::min(std::min(points[0].x, points[1].x), std::min(points[2].x, points[3].x)), max_x = std::max(std::max(points[0].x, points[1].x), std::max(points[2].x, points[3].x));
+        float min_y = std::min(std::min(points[0].y, points[1].y), std::min(points[2].y, points[3].y)), max_y = std::max(std::max(points[0].y, points[1].y), std::max(points[2].y, points[3].y));
+        int x0 = std::max(0, (int)std::floor(min_x)), x1 = std::min(width-1, (int)std::ceil(max_x) - 1);
+        int y0 = std::max(0, (int)std::floor(min_y)), y1 = std::min(height-1, (int)std::ceil(max_y) - 1);
+        if (x0 > x1 || y0 > y1) return;
+        x0 &= ~3; // Rows are written 4 pixels at a time from a multiple of 4, width being one too
+
+        for (int y = y0; y <= y1; y++){
+            float center_y = y + 0.5f;
+            float* row = &depths[y*width];
+#ifdef OCCLUSION_SSE
+            __m128 edge_start[4], edge_step[4];
+            __m128 offsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f); // Centers of the 4 pixels
+            for (int i = 0; i < 4; i++){
+                edge_start[i] = _mm_add_ps(_mm_set1_ps(a[i]*x0 + b[i]*center_y + c[i]), _mm_mul_ps(_mm_set1_ps(a[i]), offsets));
+                edge_step[i] = _mm_set1_ps(4*a[i]);
+            }
+            __m128 depth = _mm_set1_ps(farthest), zero = _mm_setzero_ps();
+            for (int x = x0; x <= x1; x += 4){
+                __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(edge_start[0], zero), _mm_cmpge_ps(edge_start[1], zero)), _mm_and_ps(_mm_cmpge_ps(edge_start[2], zero), _mm_cmpge_ps(edge_start[3], zero)));
+                int mask = _mm_movemask_ps(inside);
+                if (mask != 0){
+                    __m128 old_depth = _mm_loadu_ps(row + x);
+                    __m128 new_depth = _mm_min_ps(old_depth, depth);
+                    _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, new_depth), _mm_andnot_ps(inside, old_depth)));
+                    pixels_written += std::bitset<4>(mask).count(); // Portable, unlike __builtin_popcount
+                }
+                for (int i = 0; i < 4; i++) edge_start[i] = _mm_add_ps(edge_start[i], edge_step[i]);
+            }
+#else
+            for (int x = x0; x <= x1; x++){
+                float center_x = x + 0.5f;
+                bool inside = true;
+                for (int i = 0; i < 4; i++) inside = inside && a[i]*center_x + b[i]*center_y + c[i] >= 0;
+                if (!inside) continue;
+                row[x] = std::min(row[x], farthest);
+                pixels_written++;
+            }
+#endif
+        }
+    }
+};
+#endif
@@ -0,0 +1,190 @@
+#ifndef OCCUPANCY_TREE_H
+#define OCCUPANCY_TREE_H
+
+#include <iostream>
+#include <glm/glm.hpp>
+#include <unordered_map>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+class Occupancy_tree{ // Sparse 64-tree telling which parts of the world contain blocks, to skip empty space hierarchically
+public:
+    // Each node covers 4x4x4 nodes of the level below and stores one bit per child:
+    // level 0 is a block, level 1 a brick of 4^3 blocks, level 2 a chunk of 4^3 bricks (16^3 blocks, like Chunk), level 3 a region of 4^3 chunks (64^3 blocks)
+    static inline const int num_levels = 4;
+
+    void set(int x, int y, int z, bool solid){ // Updates the tree after block (x,y,z) became solid or empty
+        int64_t chunk_key = key(x >> 4, y >> 4, z >> 4);
+        auto it = chunk_nodes.find(chunk_key);
+        if (it == chunk_nodes.end()){
+            if (!solid) return; // Already empty
+            it = chunk_nodes.emplace(chunk_key, Chunk_node()).first;
+        }
+        Chunk_node &chunk_node = it->second;
+        int brick = child_index(x >> 2, y >> 2, z >> 2);
+        uint64_t &cells = chunk_node.cell_masks[brick];
+        uint64_t cell_bit = (uint64_t)1 << child_index(x, y, z);
+        cells = solid ? cells | cell_bit : cells & ~cell_bit;
+
+        // Propagate to the upper levels
+        uint64_t brick_bit = (uint64_t)1 << brick;
+        chunk_node.brick_mask = cells != 0 ? chunk_node.brick_mask | brick_bit : chunk_node.brick_mask & ~brick_bit;
+        chunk_node.full_brick_mask = cells == ~(uint64_t)0 ? chunk_node.full_brick_mask | brick_bit : chunk_node.full_brick_mask & ~brick_bit;
+
+        Region_node &region_node = region_nodes[key(x >> 6, y >> 6, z >> 6)];
+        uint64_t chunk_bit = (uint64_t)1 << child_index(x >> 4, y >> 4, z >> 4);
+        region_node.chunk_mask = chunk_node.brick_mask != 0 ? region_node.chunk_mask | chunk_bit : region_node.chunk_mask & ~chunk_bit;
+        region_node.full_chunk_mask = chunk_node.full_brick_mask == ~(uint64_t)0 ? region_node.full_chunk_mask | chunk_bit : region_node.full_chunk_mask & ~chunk_bit;
+        if (chunk_node.brick_mask == 0) chunk_nodes.erase(it); // Keep the tree sparse
+        if (region_node.chunk_mask == 0) region_nodes.erase(key(x >> 6, y >> 6, z >> 6));
+    }
+
+    void clear_chunk(int chunk_x, int chunk_y, int chunk_z){ // Same as setting all blocks of the chunk as empty
+        if (chunk_nodes.erase(key(chunk_x, chunk_y, chunk_z)) == 0) return;
+        auto it = region_nodes.find(key(chunk_x >> 2, chunk_y >> 2, chunk_z >> 2));
+        uint64_t chunk_bit = (uint64_t)1 << child_index(chunk_x, chunk_y, chunk_z);
+        it->second.chunk_mask &= ~chunk_bit;
+        it->second.full_chunk_mask &= ~chunk_bit;
+        if (it->second.chunk_mask == 0) region_nodes.erase(it);
+    }
+
+    void clear(){
+        chunk_nodes.clear();
+        region_nodes.clear();
+    }
+
+    bool occupied(int level, int x, int y, int z){ // Whether node (x,y,z) of the given level contains at least one block (downsampled occupancy, (x,y,z) being in units of 4^level blocks)
+        return node_state(level, x, y, z) != EMPTY;
+    }
+
+    bool full(int level, int x, int y, int z){ // Whether node (x,y,z) of the given level is completely filled with blocks
+        return node_state(level, x, y, z) == FULL;
+    }
+
+    bool region_empty(glm::ivec3 min, glm::ivec3 max){ // Whether there is no block in the box of blocks [min, max] (both included)
+        return !any_in_box(num_levels-1, min, max, EMPTY);
+    }
+
+    bool region_full(glm::ivec3 min, glm::ivec3 max){ // Whether all blocks of the box [min, max] are solid
+        return !any_in_box(num_levels-1, min, max, FULL);
+    }
+
+    bool raycast(glm::vec3 origin, glm::vec3 direction, float max_distance, glm::ivec3 &block, glm::ivec3 &normal, float &distance){
+        // Same as World::raycast, but jumps over the largest empty node containing the current position instead of moving one block at a time
+        // Returns whether a block was hit, and fills block, normal and distance like Raycast_hit
+        direction = glm::normalize(direction);
+        glm::vec3 start = origin + 0.5f; // Block (x,y,z) fills [x-0.5, x+0.5]^3, so we work in a grid shifted by 0.5
+        glm::ivec3 cell = glm::ivec3(glm::floor(start));
+        normal = glm::ivec3(0);
+        distance = 0.0f;
+        while (distance <= max_distance){
+            int level = num_levels-1; // Find the largest empty node containing cell, from the top of the tree
+            while (level >= 0 && node_state(level, cell.x >> 2*level, cell.y >> 2*level, cell.z >> 2*level) != EMPTY) level--;
+            if (level < 0){ // Even the block itself is not empty
+                block = cell;
+                return true;
+            }
+
+            // Leave the empty node of size 4^level containing cell through its closest boundary
+            int node_size = 1 << (2*level);
+            float t_exit = INFINITY;
+            int exit_axis = 0;
+            for (int axis = 0; axis < 3; axis++){
+                if (direction[axis] == 0) continue;
+                int node_min = (cell[axis] >> (2*level)) << (2*level);
+                float boundary = direction[axis] > 0 ? node_min + node_size : node_min;
+                float t = (boundary - start[axis])/direction[axis];
+                if (t < t_exit){
+                    t_exit = t;
+                    exit_axis = axis;
+                }
+            }
+            distance = std::max(distance, t_exit);
+            glm::vec3 position = start + direction*distance;
+            int step = direction[exit_axis] > 0 ? 1 : -1;
+            int node_min = (cell[exit_axis] >> (2*level)) << (2*level);
+            for (int axis = 0; axis < 3; axis++) cell[axis] = (int)std::floor(position[axis]);
+            cell[exit_axis] = step > 0 ? node_min + node_size : node_min - 1; // Exactly on the other side of the boundary, whatever the rounding of position
+            normal = glm::ivec3(0);
+            normal[exit_axis] = -step;
+        }
+        return false;
+    }
+
+    int memory_bytes(){
+        return chunk_nodes.size()*(sizeof(Chunk_node) + sizeof(int64_t)) + region_nodes.size()*(sizeof(Region_node) + sizeof(int64_t));
+    }
+
+private:
+    enum Node_state {EMPTY, PARTIAL, FULL};
+
+    struct Chunk_node{ // Levels 1 and 2 of a chunk
+        uint64_t cell_masks[64] = {}; // Blocks of each brick
+        uint64_t brick_mask = 0; // Non-empty bricks
+        uint64_t full_brick_mask = 0; // Completely filled bricks
+    };
+
+    struct Region_node{ // Level 3
+        uint64_t chunk_mask = 0; // Non-empty chunks
+        uint64_t full_chunk_mask = 0; // Completely filled chunks
+    };
+
+    std::unordered_map<int64_t, Chunk_node> chunk_nodes; // Keyed by chunk coordinates
+    std::unordered_map<int64_t, Region_node> region_nodes; // Keyed by region coordinates
+
+    static int child_index(int x, int y, int z){ // Index of a node among the 64 children of its parent, from its coordinates at its own level
+        return (x & 3) + 4*((z & 3) + 4*(y & 3));
+    }
+
+    static int64_t key(int x, int y, int z){ // Packs 3 integer coordinates on 21 bits each, like World::pack_coordinates
+        const int64_t mask = (1 << 21) - 1;
+        return ((int64_t)(x & mask) << 42) | ((int64_t)(y & mask) << 21) | (int64_t)(z & mask);
+    }
+
+    Node_state node_state(int level, int x, int y, int z){ // (x,y,z) are the coordinates of the node at its level
+        if (level == 3){
+            auto it = region_nodes.find(key(x, y, z));
+            if (it == region_nodes.end()) return EMPTY;
+            if (it->second.full_chunk_mask == ~(uint64_t)0) return FULL;
+            return PARTIAL;
+        }
+        if (level == 2){
+            auto it = chunk_nodes.find(key(x, y, z));
+            if (it == chunk_nodes.end()) return EMPTY;
+            if (it->second.full_brick_mask == ~(uint64_t)0) return FULL;
+            return PARTIAL;
+        }
+        // Levels 0 and 1 are stored in the node of their chunk
+        int shift = level == 1 ? 2 : 4; // From the level coordinates to chunk coordinates
+        auto it = chunk_nodes.find(key(x >> shift, y >> shift, z >> shift));
+        if (it == chunk_nodes.end()) return EMPTY;
+        if (level == 1){
+            uint64_t cells = it->second.cell_masks[child_index(x, y, z)];
+            return cells == 0 ? EMPTY : cells == ~(uint64_t)0 ? FULL : PARTIAL;
+        }
+        uint64_t cells = it->second.cell_masks[child_index(x >> 2, y >> 2, z >> 2)];
+        return (cells >> child_index(x, y, z) & 1) ? FULL : EMPTY;
+    }
+
+    bool any_in_box(int level, glm::ivec3 min, glm::ivec3 max, Node_state state){
+        // Whether a block of the box [min, max] is in the opposite state of state (solid if state is EMPTY, empty if state is FULL)
+        // Nodes that are entirely in state are skipped without looking at their children
+        int shift = 2*level;
+        for (int y = min.y >> shift; y <= max.y >> shift; y++){
+            for (int z = min.z >> shift; z <= max.z >> shift; z++){
+                for (int x = min.x >> shift; x <= max.x >> shift; x++){
+                    Node_state node = node_state(level, x, y, z);
+                    if (node == state) continue;
+                    if (node != PARTIAL || level == 0) return true; // Entirely in the other state
+                    // Partially filled: look at the children that overlap the box
+                    glm::ivec3 node_min = glm::ivec3(x, y, z) << shift;
+                    glm::ivec3 node_max = node_min + (1 << shift) - 1;
+                    if (any_in_box(level-1, glm::max(min, node_min), glm::min(max, node_max), state)) return true;
+                }
+            }
+        }
+        return false;
+    }
+};
+#endif
@@ -0,0 +1,172 @@
+#ifndef REGION_FILE_H
+#define REGION_FILE_H
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#ifdef _WIN32
+#include <io.h>
+#ifndef NOMINMAX
+#define NOMINMAX // Otherwise windows.h defines min and max macros, which break std::min and std::max
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include "Chunk.h"
+
+class Region_file{ // File holding the chunks of a region of size x height x size chunks, opened with mmap so that only the chunks read are paged in
+    // Layout: magic number, version, then a table of (offset, number of bytes) for each chunk of the region, then the chunks written by Chunk::write
+    // A number of bytes of 0 means the chunk is not in the file. All integers are little-endian
+public:
+    static inline const int size = 16; // Number of chunks along x and z
+    static inline const int height = 16; // Number of chunks along y. Regions are stacked along y, region region_y covering chunk_y in [region_y*height, (region_y+1)*height)
+    static inline const int num_entries = size*height*size;
+    static inline const uint32_t magic = 0x47525856; // "VXRG"
+    static inline const uint32_t version = 1;
+    static inline const int header_bytes = 8 + 8*num_entries;
+
+    Region_file(std::string path){ // Opens an existing file, is_open tells whether it worked
+#ifdef _WIN32
+        std::ifstream file(path, std::ios::binary | std::ios::ate); // No mmap, the whole file is read
+        if (!file) return;
+        buffer.resize(file.tellg());
+        file.seekg(0);
+        file.read((char*)buffer.data(), buffer.size());
+        data = buffer.data();
+        num_bytes = buffer.size();
+#else
+        file_descriptor = open(path.c_str(), O_RDONLY);
+        if (file_descriptor == -1) return;
+        struct stat file_stat;
+        if (fstat(file_descriptor, &file_stat) == 0 && file_stat.st_size > 0){
+            void* mapping = mmap(NULL, file_stat.st_size, PROT_READ, MAP_SHARED, file_descriptor, 0);
+            if (mapping != MAP_FAILED){
+                data = (const uint8_t*)mapping;
+                num_bytes = file_stat.st_size;
+            }
+        }
+#endif
+        if (data != nullptr && (num_bytes < header_bytes || read_uint32(0) != magic || read_uint32(4) != version)){
+            std::cout << "Region file " << path << " is invalid and is ignored" << std::endl;
+            close_file();
+        }
+    }
+
+    Region_file(const Region_file&) = delete; // Owns the mapping
+    Region_file& operator=(const Region_file&) = delete;
+
+    ~Region_file(){
+        close_file();
+    }
+
+    bool is_open(){
+        return data != nullptr;
+    }
+
+    const uint8_t* chunk_data(int index, int &chunk_bytes){ // Bytes of a chunk (see entry_index), nullptr if it is not in the file
+        chunk_bytes = 0;
+        if (data == nullptr) return nullptr;
+        uint32_t offset = read_uint32(8 + 8*index), length = read_uint32(8 + 8*index + 4);
+        if (length == 0 || offset < header_bytes || (uint64_t)offset + length > num_bytes) return nullptr;
+        chunk_bytes = length;
+        return data + offset;
+    }
+
+    bool has_chunk(int index){
+        int chunk_bytes;
+        return chunk_data(index, chunk_bytes) != nullptr;
+    }
+
+    bool read_chunk(int index, Chunk &chunk){ // Fills chunk from the file, returns false if the chunk is not in the file
+        int chunk_bytes;
+        const uint8_t* bytes = chunk_data(index, chunk_bytes);
+        return bytes != nullptr && chunk.read(bytes, chunk_bytes);
+    }
+
+    static int entry_index(int local_x, int local_y, int local_z){ // Index in the table of the chunk at these coordinates inside the region
+        return local_x + size*(local_z + size*local_y);
+    }
+
+    static bool write(std::string path, const std::vector<std::vector<uint8_t>> &entries){ // Writes a whole region file, entries being the bytes of each chunk (empty if absent)
+        // The file is first written next to the old one, synced, then renamed and the rename synced, so that a crash never leaves a half-written region
+        // Returns true only once the new file is on disk, e.g. before the edits it contains can be removed from the journal
+        std::vector<uint8_t> header(header_bytes, 0);
+        write_uint32(header, 0, magic);
+        write_uint32(header, 4, version);
+        uint32_t offset = header_bytes;
+        for (int index = 0; index < num_entries; index++){
+            if (entries[index].empty()) continue;
+            write_uint32(header, 8 + 8*index, offset);
+            write_uint32(header, 8 + 8*index + 4, entries[index].size());
+            offset += entries[index].size();
+        }
+        std::string temporary_path = path + ".tmp";
+        FILE* file = std::fopen(temporary_path.c_str(), "wb");
+        if (file == nullptr){
+            std::cout << "Could not write region file " << temporary_path << std::endl;
+            return false;
+        }
+        bool written = std::fwrite(header.data(), 1, header.size(), file) == header.size();
+        for (const std::vector<uint8_t> &entry: entries) if (!entry.empty()) written = written && std::fwrite(entry.data(), 1, entry.size(), file) == entry.size();
+        written = written && std::fflush(file) == 0;
+#ifdef _WIN32
+        written = written && _commit(_fileno(file)) == 0;
+#else
+        written = written && fsync(fileno(file)) == 0;
+#endif
+        written = std::fclose(file) == 0 && written;
+        if (!written){
+            std::cout << "Could not write region file " << temporary_path << std::endl;
+            return false;
+        }
+#ifdef _WIN32
+        return MoveFileExA(temporary_path.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0; // Returns once the rename is on disk
+#else
+        if (std::rename(temporary_path.c_str(), path.c_str()) != 0) return false; // Open mappings of the old file stay valid until they are closed
+        size_t slash = path.find_last_of('/');
+        int directory = open(slash == std::string::npos ? "." : path.substr(0, slash + 1).c_str(), O_RDONLY); // The rename is only durable once the directory is synced
+        if (directory == -1) return false;
+        bool synced = fsync(directory) == 0;
+        close(directory);
+        return synced;
+#endif
+    }
+
+private:
+    const uint8_t* data = nullptr; // Content of the file
+    uint64_t num_bytes = 0;
+#ifdef _WIN32
+    std::vector<uint8_t> buffer;
+#else
+    int file_descriptor = -1;
+#endif
+
+    void close_file(){
+#ifdef _WIN32
+        buffer.clear();
+#else
+        if (data != nullptr) munmap((void*)data, num_bytes);
+        if (file_descriptor != -1) close(file_descriptor);
+        file_descriptor = -1;
+#endif
+        data = nullptr;
+        num_bytes = 0;
+    }
+
+    uint32_t read_uint32(uint64_t position){
+        return data[position] | (data[position+1] << 8) | (data[position+2] << 16) | ((uint32_t)data[position+3] << 24);
+    }
+
+    static void write_uint32(std::vector<uint8_t> &bytes, int position, uint32_t value){
+        for (int i = 0; i < 4; i++) bytes[position + i] = (value >> (8*i)) & 0xFF;
+    }
+};
+#endif
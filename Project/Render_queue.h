@@ -0,0 +1,105 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <chrono>
+#include <random>
+#include "Chunk_mesh.h"
+#include "Shader.h"
+
+struct Render_item{ // One draw call: the faces of one block ID in one chunk mesh
+    uint64_t key; // See Render_queue::make_key
+    Shader* shader; // Shader whose uniforms are already set for the pass
+    Chunk_mesh* mesh;
+    Chunk_mesh_range range;
+};
+
+class Render_queue{ // Draw items submitted by the passes in any order, sorted by key so that items with the same program and texture are drawn one after another
+public:
+    enum Pass{opaque_pass, transparent_pass}; // Passes are drawn in this order
+    std::vector<Render_item> items;
+
+    static uint64_t make_key(Pass pass, unsigned int program, unsigned int texture, float depth){
+        // Opaque items: pass (4 bits), program (8 bits), texture (20 bits), depth (32 bits), drawn front to back in each texture so that the depth test rejects more fragments
+        // Transparent items: pass, depth, program, texture, drawn back to front for blending and only then grouped by state
+        uint32_t depth_bits;
+        std::memcpy(&depth_bits, &depth, sizeof(float)); // Non-negative floats have the same order as their bits
+        uint64_t state = ((uint64_t)(program & 0xFF) << 20) | (texture & 0xFFFFF);
+        if (pass == opaque_pass) return ((uint64_t)pass << 60) | (state << 32) | depth_bits;
+        return ((uint64_t)pass << 60) | ((uint64_t)~depth_bits << 28) | state;
+    }
+
+    static unsigned int key_texture(uint64_t key){ // Texture of a key made by make_key
+        return (key >> 60) == opaque_pass ? (key >> 32) & 0xFFFFF : key & 0xFFFFF;
+    }
+
+    void clear(){
+        items.clear();
+    }
+
+    void submit(const Render_item &item){
+        items.push_back(item);
+    }
+
+    void sort(){ // Radix sort of the items by key, one byte at a time from the lowest, skipping the bytes that are the same in all keys. Stable
+        // The keys are sorted with the index of their item, and the items are moved once at the end
+        keys.resize(items.size());
+        sorted_keys.resize(items.size());
+        for (int i = 0; i < items.size(); i++) keys[i] = std::make_pair(items[i].key, i);
+        int counts[8][256] = {}; // Histograms of all the bytes, computed in one go
+        for (const Render_item &item: items){
+            for (int byte = 0; byte < 8; byte++) counts[byte][(item.key >> (8*byte)) & 0xFF]++;
+        }
+        for (int byte = 0; byte < 8; byte++){
+            if (items.empty() || counts[byte][(items[0].key >> (8*byte)) & 0xFF] == items.size()) continue; // Nothing to reorder for this byte
+            int offsets[256];
+            int offset = 0;
+            for (int value = 0; value < 256; value++){
+                offsets[value] = offset;
+                offset += counts[byte][value];
+            }
+            for (const std::pair<uint64_t, int> &key: keys) sorted_keys[offsets[(key.first >> (8*byte)) & 0xFF]++] = key;
+            keys.swap(sorted_keys);
+        }
+        sorted_items.resize(items.size());
+        for (int i = 0; i < items.size(); i++) sorted_items[i] = items[keys[i].second];
+        items.swap(sorted_items);
+    }
+
+    static void benchmark(){ // Prints the time to sort the draw items of a frame with sort and with std::stable_sort (checked to give the same order by the tests)
+        const int num_items = 20000, num_repeats = 200;
+        std::mt19937 random(0);
+        std::uniform_real_distribution<float> distance(0.0f, 500.0f);
+        Render_queue queue, reference;
+        for (int i = 0; i < num_items; i++){
+            Pass pass = i % 8 == 0 ? transparent_pass : opaque_pass;
+            Render_item item = {make_key(pass, 3, 1 + random() % 7, distance(random)), nullptr, nullptr, {0, i, 6}};
+            queue.submit(item);
+        }
+        std::vector<Render_item> submitted = queue.items;
+        double radix_time = 0.0, std_time = 0.0;
+        for (int repeat = 0; repeat < num_repeats; repeat++){
+            queue.items = submitted;
+            auto start = std::chrono::steady_clock::now();
+            queue.sort();
+            radix_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            reference.items = submitted;
+            start = std::chrono::steady_clock::now();
+            std::stable_sort(reference.items.begin(), reference.items.end(), [](const Render_item &a, const Render_item &b){ return a.key < b.key; });
+            std_time += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        }
+        int texture_binds = 0;
+        for (int i = 0; i < num_items; i++) if (i == 0 || key_texture(queue.items[i].key) != key_texture(queue.items[i-1].key)) texture_binds++;
+        std::cout << "Render queue of " << num_items << " items: radix sort in " << 1000*radix_time/num_repeats << " ms, std::stable_sort in " << 1000*std_time/num_repeats << " ms, "
+                  << texture_binds << " texture binds once sorted instead of " << num_items << std::endl;
+    }
+
+private:
+    std::vector<std::pair<uint64_t, int>> keys, sorted_keys; // Kept between frames to avoid allocations
+    std::vector<Render_item> sorted_items;
+};
+#endif
@@ -0,0 +1,118 @@
+#ifndef STRUCTURE_H
+#define STRUCTURE_H
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <filesystem>
+#include <cstdint>
+#include <cstdlib>
+#include <glm/glm.hpp>
+
+struct Structure_block{ // Block of a structure, at an offset from its anchor
+    int8_t x, y, z;
+    uint8_t block;
+};
+
+class Structure{ // Template of blocks placed by the terrain generator relative to an anchor, which is the ground block of the column where the structure grows
+    // Loaded from a text file (see Structures/spruce.txt):
+    //   frequency f      probability that the structure grows on a given column
+    //   at i j           column where it always grows (optional, repeated)
+    //   block c id       character c of the layers is block ID id
+    //   anchor x y z     position of the anchor in the layers: column x, line z of layer y
+    //   layer            followed by the lines of a horizontal layer, from the lowest layer to the highest. '.' means that the block is left as it is
+public:
+    std::string name; // File name without extension
+    float frequency = 0.0f;
+    std::vector<std::pair<int, int>> fixed_columns;
+    std::vector<Structure_block> blocks; // In the order they are placed: layer by layer, then line by line
+    glm::ivec3 min = glm::ivec3(0), max = glm::ivec3(0); // Bounds of the offsets of blocks
+
+    static bool load(std::string path, Structure &structure){ // Returns false (and prints why) if the file can't be read or is invalid
+        std::ifstream file(path);
+        if (!file.is_open()){
+            std::cout << "Could not open structure " << path << std::endl;
+            return false;
+        }
+        structure = Structure();
+        structure.name = std::filesystem::path(path).stem().string();
+        std::map<char, uint8_t> legend;
+        glm::ivec3 anchor(0);
+        std::vector<std::vector<std::string>> layers;
+        std::string line;
+        int line_number = 0;
+        auto fail = [&](std::string reason){
+            std::cout << "Structure " << path << ", line " << line_number << ": " << reason << std::endl;
+            return false;
+        };
+        while (std::getline(file, line)){
+            line_number++;
+            if (!line.empty() && line.back() == '\r') line.pop_back(); // Files edited on Windows
+            if (line.empty() || line[0] == '#') continue;
+            std::istringstream words(line);
+            std::string keyword;
+            words >> keyword;
+            if (keyword == "frequency"){
+                if (!(words >> structure.frequency)) return fail("expected a frequency");
+            }
+            else if (keyword == "at"){
+                std::pair<int, int> column;
+                if (!(words >> column.first >> column.second)) return fail("expected the coordinates of a column");
+                structure.fixed_columns.push_back(column);
+            }
+            else if (keyword == "block"){
+                char symbol;
+                int block;
+                if (!(words >> symbol >> block) || block <= 0 || block > 255) return fail("expected a character and a block ID");
+                legend[symbol] = block;
+            }
+            else if (keyword == "anchor"){
+                if (!(words >> anchor.x >> anchor.y >> anchor.z)) return fail("expected the position of the anchor");
+            }
+            else if (keyword == "layer") layers.push_back({});
+            else if (!layers.empty()) layers.back().push_back(line);
+            else return fail("unknown keyword " + keyword);
+        }
+
+        for (int y = 0; y < layers.size(); y++){
+            for (int z = 0; z < layers[y].size(); z++){
+                for (int x = 0; x < layers[y][z].size(); x++){
+                    char symbol = layers[y][z][x];
+                    if (symbol == '.' || symbol == ' ') continue;
+                    if (legend.count(symbol) == 0) return fail("character " + std::string(1, symbol) + " of layer " + std::to_string(y) + " has no block");
+                    glm::ivec3 offset = glm::ivec3(x, y, z) - anchor;
+                    if (glm::any(glm::lessThan(offset, glm::ivec3(-128))) || glm::any(glm::greaterThan(offset, glm::ivec3(127)))) return fail("structure too large");
+                    structure.blocks.push_back({(int8_t)offset.x, (int8_t)offset.y, (int8_t)offset.z, legend[symbol]});
+                    structure.min = glm::min(structure.min, offset);
+                    structure.max = glm::max(structure.max, offset);
+                }
+            }
+        }
+        return true;
+    }
+
+    static std::vector<Structure> load_directory(std::string directory){ // Loads all the .txt files of directory, sorted by name so that the terrain doesn't depend on the order of the files on disk
+        std::vector<std::string> paths;
+        std::error_code error;
+        for (auto &entry: std::filesystem::directory_iterator(directory, error)){
+            if (entry.path().extension() == ".txt") paths.push_back(entry.path().string());
+        }
+        if (error) std::cout << "Could not read structures directory " << directory << std::endl;
+        std::sort(paths.begin(), paths.end());
+        std::vector<Structure> structures;
+        for (std::string &path: paths){
+            Structure structure;
+            if (load(path, structure)) structures.push_back(structure);
+        }
+        return structures;
+    }
+
+    int horizontal_reach() const { // Farthest horizontal distance of a block from the anchor, in blocks along x or z
+        return std::max(std::max(-min.x, max.x), std::max(-min.z, max.z));
+    }
+};
+#endif
@@ -28,7 +28,7 @@ class Target: public Drawable{
 
     void draw_axis(){
         // Send matrices for the target to stay in the middle of the screen
-        glDepthMask(GL_FALSE); // Needed otherwise when we click the detected depth is 0 (because the target is in front of all other objects)
+        glDepthMask(GL_FALSE); // The target should never hide or be hidden by the objects of the scene
         draw({glm::vec3(0.0f)}, glm::mat4{1.0f}, glm::mat4{1.0f}, shader, -1, 4, GL_LINES, false, false); // -1 because we don't want a texture
         glDepthMask(GL_TRUE);
     }
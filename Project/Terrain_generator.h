@@ -0,0 +1,167 @@
+#ifndef TERRAIN_GENERATOR_H
+#define TERRAIN_GENERATOR_H
+
+#include <iostream>
+#include <vector>
+#include <cstdint>
+#include <cmath>
+#include <map>
+#include <climits>
+#include <chrono>
+#include "Chunk.h"
+#include "Structure.h"
+#include "Noise.h"
+
+class Terrain_generator{ // Deterministic generation of the terrain, chunk column by chunk column. Only reads its seed so it can be used from several threads at once
+public:
+    static inline const int num_chunks_y = 2; // The terrain (structures included) stays between y = 0 and y = num_chunks_y*Chunk::size
+    static inline const uint8_t grass = 1, dirt = 2, spruce = 4, leaf = 6; // Block IDs of the terrain (registration order of Block_registry, see files_textures in Main.cpp)
+
+    int seed;
+
+    Terrain_generator(int seed, std::vector<Structure> structures = {}): noise(seed){ // structures grow on the terrain, e.g. trees loaded by Structure::load_directory
+        this->seed = seed;
+        this->structures = structures;
+        fixed_min = std::make_pair(INT_MAX, INT_MAX);
+        fixed_max = std::make_pair(INT_MIN, INT_MIN);
+        for (int k = 0; k < structures.size(); k++){
+            thresholds.push_back((uint32_t)std::min(4294967295.0, (double)structures[k].frequency*4294967296.0));
+            for (std::pair<int, int> column: structures[k].fixed_columns){
+                fixed_columns[column] = k;
+                fixed_min = std::make_pair(std::min(fixed_min.first, column.first), std::min(fixed_min.second, column.second));
+                fixed_max = std::make_pair(std::max(fixed_max.first, column.first), std::max(fixed_max.second, column.second));
+            }
+            structure_reach = std::max(structure_reach, structures[k].horizontal_reach());
+        }
+        relief.octaves = 3;
+        relief.frequency = 1.0f/64;
+    }
+
+    int altitude(int i, int j) const { // Height of the grass block of column (i,j), same as in generate_column
+        return altitude(cos_i(i), cos_j(j), noise.fbm2((float)i, (float)j, relief));
+    }
+
+    const Structure* structure_at(int i, int j) const { // Structure growing on column (i,j), nullptr if none. At most one structure grows on a column, the first whose random test passes
+        if (!fixed_columns.empty() && i >= fixed_min.first && i <= fixed_max.first && j >= fixed_min.second && j <= fixed_max.second){ // Few columns are fixed, so the map is rarely looked up
+            auto fixed = fixed_columns.find(std::make_pair(i, j));
+            if (fixed != fixed_columns.end()) return &structures[fixed->second];
+        }
+        for (int k = 0; k < structures.size(); k++){
+            if (hash(i, j, k) < thresholds[k]) return &structures[k];
+        }
+        return nullptr;
+    }
+
+    std::vector<Chunk> generate_column(int chunk_x, int chunk_z) const { // Generates the chunks (chunk_x, 0..num_chunks_y-1, chunk_z), skipping empty ones
+        const int size = Chunk::size;
+        std::vector<Chunk> chunks;
+        for (int chunk_y = 0; chunk_y < num_chunks_y; chunk_y++) chunks.push_back(Chunk(chunk_x, chunk_y, chunk_z));
+        auto place = [&](int x, int y, int z, uint8_t block){ // Sets the block at world coordinates (x,y,z) if it is in the column
+            int local_x = x - chunk_x*size, local_z = z - chunk_z*size;
+            if (local_x < 0 || local_x >= size || local_z < 0 || local_z >= size || y < 0 || y >= num_chunks_y*size) return;
+            chunks[y/size].set(local_x, y%size, local_z, block);
+        };
+
+        // Altitudes of the column. The noise of the whole heightmap is computed at once, and the cosines only once per row and per line
+        int first_i = chunk_x*size, first_j = chunk_z*size;
+        float relief_values[size*size];
+        noise.fbm2_grid(first_i, first_j, size, size, relief, relief_values);
+        double cos_i_values[size], cos_j_values[size];
+        for (int k = 0; k < size; k++){
+            cos_i_values[k] = cos_i(first_i + k);
+            cos_j_values[k] = cos_j(first_j + k);
+        }
+        int altitudes[size][size]; // Indexed by [local_z][local_x]
+        for (int j = 0; j < size; j++){
+            for (int i = 0; i < size; i++) altitudes[j][i] = altitude(cos_i_values[i], cos_j_values[j], relief_values[i + size*j]);
+        }
+
+        // Dirt blocks until altitude-1 then a grass block at altitude, the altitude being on the y-axis
+        for (int local_z = 0; local_z < size; local_z++){
+            for (int local_x = 0; local_x < size; local_x++){
+                int i = first_i + local_x, j = first_j + local_z;
+                int top = altitudes[local_z][local_x];
+                for (int k = 0; k < top; k++) place(i, k, j, dirt);
+                place(i, top, j, grass);
+            }
+        }
+
+        // Then structures. A structure crossing chunk borders is placed piece by piece: each column places the part of the structures anchored in it or in
+        // the columns around it that overlaps it, so the rest of a structure is deferred until the neighbouring columns are generated. Whether and where
+        // a structure grows only depends on the seed and its anchor column, so the pieces match whatever the order and the thread the columns are generated in
+        for (int j = first_j - structure_reach; j < first_j + size + structure_reach; j++){
+            for (int i = first_i - structure_reach; i < first_i + size + structure_reach; i++){
+                const Structure* structure = structure_at(i, j);
+                if (structure == nullptr) continue;
+                if (i + structure->max.x < first_i || i + structure->min.x >= first_i + size || j + structure->max.z < first_j || j + structure->min.z >= first_j + size) continue;
+                bool inside = i >= first_i && i < first_i + size && j >= first_j && j < first_j + size;
+                int top = inside ? altitudes[j - first_j][i - first_i] : altitude(i, j); // Anchors outside of the column are rare, so their altitude is computed alone
+                for (const Structure_block &block: structure->blocks) place(i + block.x, top + block.y, j + block.z, block.block);
+            }
+        }
+
+        std::vector<Chunk> non_empty_chunks;
+        for (Chunk &chunk: chunks) if (!chunk.empty()) non_empty_chunks.push_back(chunk);
+        return non_empty_chunks;
+    }
+
+    static void benchmark(std::vector<Structure> structures, int seed){ // Prints the generation speed of a 1024 x 1024 blocks area without structures, with structures, and with 25 times more of them
+        const int num_chunks_side = 1024/Chunk::size;
+        std::vector<Structure> dense = structures;
+        for (Structure &structure: dense) structure.frequency *= 25;
+        std::vector<std::pair<std::string, Terrain_generator>> generators = {{"without structures", Terrain_generator(seed)},
+            {"with structures", Terrain_generator(seed, structures)}, {"dense forest", Terrain_generator(seed, dense)}};
+        for (auto &pair: generators){
+            Terrain_generator &generator = pair.second;
+            int num_structures = 0;
+            for (int j = 0; j < num_chunks_side*Chunk::size; j++){
+                for (int i = 0; i < num_chunks_side*Chunk::size; i++) if (generator.structure_at(i, j) != nullptr) num_structures++;
+            }
+            long long num_blocks = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (int chunk_x = 0; chunk_x < num_chunks_side; chunk_x++){
+                for (int chunk_z = 0; chunk_z < num_chunks_side; chunk_z++){
+                    for (Chunk &chunk: generator.generate_column(chunk_x, chunk_z)) num_blocks += chunk.num_blocks;
+                }
+            }
+            double time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            std::cout << "Terrain " << pair.first << ": " << num_structures << " structures, " << (int)(num_chunks_side*num_chunks_side/time) << " columns per second ("
+                      << num_blocks << " blocks)" << std::endl;
+        }
+    }
+
+private:
+    Noise noise;
+    std::vector<Structure> structures;
+    std::vector<uint32_t> thresholds; // A structure grows on a column if the hash of the column is below its threshold (frequency*2^32)
+    std::map<std::pair<int, int>, int> fixed_columns; // Index in structures of the structure always growing on each column (i,j)
+    std::pair<int, int> fixed_min, fixed_max; // Bounding box of fixed_columns
+    int structure_reach = 0; // Horizontal reach of the largest structure, structures anchored this far from a column can overlap it
+    Fbm relief; // Noise added to the altitude function so that the terrain doesn't repeat
+
+    // Custom altitude function, with noise on top of it. The noise is 0 at integer coordinates of each octave, so the column at (0,0) keeps the altitude of the original map
+    static double cos_i(int i){
+        return cos((2*(float)i+15)/80*M_PI);
+    }
+
+    static double cos_j(int j){
+        return cos(((float)j+12)/80*4*M_PI);
+    }
+
+    static int altitude(double cos_i, double cos_j, float relief){
+        float height = cos_i + cos_j + 4;
+        height += 4.0f*relief;
+        return std::max(0, (int)round(height));
+    }
+
+    uint32_t hash(int i, int j, int salt) const { // Well mixed integer from the column coordinates, the seed and salt
+        uint32_t h = (uint32_t)i * 0x8da6b343u ^ (uint32_t)j * 0xd8163841u ^ (uint32_t)seed * 0xcb1ab31fu ^ (uint32_t)salt * 0x9e3779b9u;
+        h ^= h >> 16;
+        h *= 0x7feb352du;
+        h ^= h >> 15;
+        h *= 0x846ca68bu;
+        h ^= h >> 16;
+        return h;
+    }
+};
+#endif
@@ -0,0 +1,380 @@
+// Checks of the parts of the game that don't need a window: run by ctest, returns a non-zero exit code if one of them fails
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstring>
+#include <random>
+#include <filesystem>
+#include "Noise.h"
+#include "World_save.h"
+#include "Edit_journal.h"
+#include "Edit_history.h"
+#include "World.h"
+#include "Frustum.h"
+#include "Occlusion_buffer.h"
+#include "Render_queue.h"
+#include "Chunk_mesher.h"
+
+int num_failures = 0;
+
+void check(bool condition, std::string description){ // Prints description and counts a failure if condition is false
+    if (condition) return;
+    std::cout << "FAILED: " << description << std::endl;
+    num_failures++;
+}
+
+void test_noise_backends(){ // The SIMD backends give bit-for-bit the same values as the scalar one, so that the terrain doesn't depend on the CPU
+    const int size = 16;
+    Fbm fbm;
+    fbm.frequency = 1.0f/64;
+    Noise scalar(1234, Noise::SCALAR);
+    for (int backend = Noise::SSE2; backend <= Noise::AVX2; backend++){
+        if (!Noise::supported((Noise::Backend)backend)) continue;
+        Noise noise(1234, (Noise::Backend)backend);
+        for (int chunk = -3; chunk <= 3; chunk++){
+            std::vector<float> reference_2D(size*size), values_2D(size*size), reference_3D(size*size*size), values_3D(size*size*size);
+            scalar.fbm2_grid(chunk*size, -chunk*size, size, size, fbm, &reference_2D[0]);
+            noise.fbm2_grid(chunk*size, -chunk*size, size, size, fbm, &values_2D[0]);
+            scalar.fbm3_grid(chunk*size, -chunk*size, chunk*size, size, size, size, fbm, &reference_3D[0]);
+            noise.fbm3_grid(chunk*size, -chunk*size, chunk*size, size, size, size, fbm, &values_3D[0]);
+            check(std::memcmp(&values_2D[0], &reference_2D[0], values_2D.size()*sizeof(float)) == 0, Noise::backend_names[backend] + " heightmap of chunk " + std::to_string(chunk) + " differs from scalar");
+            check(std::memcmp(&values_3D[0], &reference_3D[0], values_3D.size()*sizeof(float)) == 0, Noise::backend_names[backend] + " density field of chunk " + std::to_string(chunk) + " differs from scalar");
+        }
+    }
+}
+
+bool same_blocks(const Chunk &a, const Chunk &b){
+    if (a.chunk_x != b.chunk_x || a.chunk_y != b.chunk_y || a.chunk_z != b.chunk_z || a.num_blocks != b.num_blocks) return false;
+    for (int y = 0; y < Chunk::size; y++) for (int z = 0; z < Chunk::size; z++) for (int x = 0; x < Chunk::size; x++) if (a.get(x, y, z) != b.get(x, y, z)) return false;
+    return true;
+}
+
+void test_region_round_trip(){ // Columns saved in region files are loaded back identical, on both sides of region borders
+    std::string directory = (std::filesystem::temp_directory_path() / "voxel_tests_regions/").string();
+    std::filesystem::remove_all(directory);
+    Terrain_generator generator(502);
+    std::vector<Chunk_column> generated;
+    for (int chunk_x = -20; chunk_x < 20; chunk_x++){
+        for (int chunk_z = -20; chunk_z < 20; chunk_z += 3) generated.push_back({chunk_x, chunk_z, generator.generate_column(chunk_x, chunk_z)});
+    }
+    check(World_save(directory).save_columns(generated) == 0, "some chunks could not be saved");
+    World_save save(directory);
+    for (Chunk_column &column: generated){
+        Chunk_column loaded;
+        std::string name = "column (" + std::to_string(column.chunk_x) + ", " + std::to_string(column.chunk_z) + ")";
+        check(save.load_column(column.chunk_x, column.chunk_z, loaded), name + " was not found in the save");
+        check(loaded.chunks.size() == column.chunks.size(), name + " has a different number of chunks once loaded");
+        for (int c = 0; c < std::min(loaded.chunks.size(), column.chunks.size()); c++) check(same_blocks(loaded.chunks[c], column.chunks[c]), name + " has different blocks once loaded");
+    }
+    Chunk_column never_saved;
+    check(!save.load_column(100, 100, never_saved), "a column that was never saved is found");
+    std::filesystem::remove_all(directory);
+}
+
+void test_tall_columns(){ // Blocks above and below the first 256 blocks, like an edit at y 300, survive a save and a reload
+    std::string directory = (std::filesystem::temp_directory_path() / "voxel_tests_tall_columns/").string();
+    std::filesystem::remove_all(directory);
+    Chunk_column column{-1, 3, Terrain_generator(502).generate_column(-1, 3)};
+    Chunk high(-1, 300/Chunk::size, 3), low(-1, -2, 3);
+    high.set(5, 300 - high.chunk_y*Chunk::size, 7, 1);
+    low.set(0, 0, 0, 2);
+    column.chunks.push_back(high);
+    column.chunks.insert(column.chunks.begin(), low);
+    check(World_save(directory).save_columns({column}) == 0, "chunks outside the first 256 blocks could not be saved");
+    Chunk_column loaded;
+    check(World_save(directory).load_column(-1, 3, loaded), "the tall column was not found in the save");
+    check(loaded.chunks.size() == column.chunks.size(), "the tall column has a different number of chunks once loaded");
+    for (int c = 0; c < std::min(loaded.chunks.size(), column.chunks.size()); c++) check(same_blocks(loaded.chunks[c], column.chunks[c]), "the tall column has different blocks once loaded");
+
+    column.chunks.pop_back(); // Saving the column again without its highest chunk removes it from the save
+    check(World_save(directory).save_columns({column}) == 0, "the tall column could not be saved again");
+    check(World_save(directory).load_column(-1, 3, loaded) && loaded.chunks.size() == column.chunks.size(), "a chunk removed from the tall column is still in the save");
+    std::filesystem::remove_all(directory);
+}
+
+void test_failed_save(){ // The callback of an asynchronous save, which lets Map trim the journal, is not called when a region file can't be written
+    std::string directory = (std::filesystem::temp_directory_path() / "voxel_tests_failed_save/").string();
+    std::filesystem::remove_all(directory);
+    std::filesystem::create_directories(directory + "r.0.0.region"); // A directory can't be replaced by the region file
+    bool called = false;
+    {
+        World_save save(directory);
+        save.save_columns_async({{0, 0, Terrain_generator(502).generate_column(0, 0)}}, [&]{ called = true; });
+        save.wait_for_saves();
+    }
+    check(!called, "the callback of a failed save is called");
+    std::filesystem::remove_all(directory);
+}
+
+void test_corrupted_chunks(){ // Chunk::read rejects data whose indices are outside the palette or disagree with the palette counts
+    Chunk chunk(0, 0, 0);
+    for (int x = 0; x < Chunk::size; x++) chunk.set(x, 3, 5, 1 + x % 2); // Palette of air and 2 blocks, 2 bits per block
+    std::vector<uint8_t> bytes;
+    chunk.write(bytes);
+    Chunk read(0, 0, 0);
+    check(read.read(&bytes[0], bytes.size()) && same_blocks(read, chunk), "a valid chunk is not read back identical");
+
+    int palette_size = bytes[1] | (bytes[2] << 8), first_index_byte = 3 + 3*palette_size;
+    check(chunk.get_bits_per_block() == 2 && palette_size == 3, "unexpected palette in the corruption test");
+    std::vector<uint8_t> bad_index = bytes;
+    bad_index[first_index_byte] = 0xFF; // Index 3 in a palette of 3 entries
+    check(!read.read(&bad_index[0], bad_index.size()), "a chunk with an index outside its palette is accepted");
+    std::vector<uint8_t> bad_count = bytes;
+    bad_count[3 + palette_size]++;
+    check(!read.read(&bad_count[0], bad_count.size()), "a chunk whose palette counts don't match its indices is accepted");
+    check(!read.read(&bytes[0], bytes.size() - 1), "a truncated chunk is accepted");
+    check(same_blocks(read, chunk), "a rejected chunk changed the blocks");
+}
+
+bool same_edits(const std::vector<Block_edit> &a, const std::vector<Block_edit> &b){
+    if (a.size() != b.size()) return false;
+    for (int i = 0; i < a.size(); i++) if (a[i].x != b[i].x || a[i].y != b[i].y || a[i].z != b[i].z || a[i].block != b[i].block) return false;
+    return true;
+}
+
+void test_journal_replay(){ // The journal gives back the edits in order after being reopened, and drops a batch cut by a crash
+    std::string path = (std::filesystem::temp_directory_path() / "voxel_tests_journal.bin").string();
+    std::remove(path.c_str());
+    std::mt19937 random(0);
+    std::vector<Block_edit> edits, first_batch;
+    {
+        Edit_journal journal(path, 10.0); // Only written by sync and when closed
+        for (int batch = 0; batch < 3; batch++){
+            for (int i = 0; i < 1000; i++){
+                Block_edit edit = {(int)(random() % 2048) - 1024, (int)(random() % 64), (int)(random() % 2048) - 1024, (uint8_t)(random() % 8)};
+                journal.append(edit.x, edit.y, edit.z, edit.block);
+                edits.push_back(edit);
+            }
+            journal.sync();
+            if (batch == 0) first_batch = edits;
+        }
+    }
+    {
+        Edit_journal journal(path, 10.0);
+        check(same_edits(journal.read_all(), edits), "the journal doesn't replay the edits it was given");
+    }
+    std::filesystem::resize_file(path, 4 + 1000*13 + 4 + 100); // Crash in the middle of the second batch
+    {
+        Edit_journal journal(path, 10.0);
+        check(same_edits(journal.read_all(), first_batch), "the journal doesn't stop at a batch cut by a crash");
+    }
+    std::remove(path.c_str());
+}
+
+void test_edit_history(){ // A transaction that changes nothing, like an edit to the same block after an undo, keeps the undone transactions for redo
+    Edit_history history(1000);
+    std::vector<Block_delta> changes;
+    history.record(1, 2, 3, 0, 5);
+    check(history.undo(changes) && changes.size() == 1 && changes[0].new_block == 0, "an edit is not undone");
+    history.begin_transaction();
+    history.record(4, 5, 6, 7, 7); // Sets a block to what it already is
+    history.end_transaction();
+    check(history.redo(changes) && changes.size() == 1 && changes[0].new_block == 5, "redo doesn't work after a transaction that changed nothing");
+    check(history.undo(changes), "the redone edit can't be undone");
+    history.record(1, 2, 3, 0, 6);
+    check(!history.redo(changes), "an undone edit can be redone after a new edit");
+    check(history.undo(changes) && changes.size() == 1 && changes[0].old_block == 6 && !history.undo(changes), "the new edit is not the only one left to undo");
+}
+
+void test_bulk_edits(){ // The bulk edits of World give the same blocks as setting them one by one, and record exactly the blocks they change
+    glm::ivec3 min(-37, -5, -21), max(50, 40, 60); // Not aligned on chunks
+    World bulk, reference, replayed; // replayed only gets the recorded changes
+    std::mt19937 random(0);
+    auto compare = [&](std::string name, const std::vector<Block_delta> &changes){
+        bool old_blocks_match = true;
+        for (const Block_delta &change: changes){
+            old_blocks_match = old_blocks_match && replayed.get(change.x, change.y, change.z) == change.old_block;
+            replayed.set(change.x, change.y, change.z, change.new_block);
+        }
+        check(old_blocks_match, name + " records changes whose old block is wrong");
+        int num_different = 0, num_missing_changes = 0;
+        for (int y = min.y - 20; y <= max.y + 20; y++){
+            for (int z = min.z - 20; z <= max.z + 20; z++){
+                for (int x = min.x - 20; x <= max.x + 20; x++){
+                    num_different += bulk.get(x, y, z) != reference.get(x, y, z);
+                    num_missing_changes += bulk.get(x, y, z) != replayed.get(x, y, z);
+                }
+            }
+        }
+        check(num_different == 0, name + " differs from setting the blocks one by one on " + std::to_string(num_different) + " blocks");
+        check(num_missing_changes == 0, name + " doesn't record the change of " + std::to_string(num_missing_changes) + " blocks");
+    };
+
+    std::vector<Block_delta> changes;
+    bulk.fill(min, max, 2, &changes);
+    for (int y = min.y; y <= max.y; y++) for (int z = min.z; z <= max.z; z++) for (int x = min.x; x <= max.x; x++) reference.set(x, y, z, 2);
+    compare("fill", changes);
+
+    for (int i = 0; i < 5000; i++){ // Other blocks scattered so that the chunks are not all uniform
+        int x = min.x + random() % (max.x-min.x+1), y = min.y + random() % (max.y-min.y+1), z = min.z + random() % (max.z-min.z+1);
+        for (World* world: {&bulk, &reference, &replayed}) world->set(x, y, z, i % 4);
+    }
+    changes.clear();
+    glm::ivec3 replace_min = min + 3, replace_max = max - 5;
+    bulk.replace(replace_min, replace_max, 2, 5, &changes);
+    for (int y = replace_min.y; y <= replace_max.y; y++) for (int z = replace_min.z; z <= replace_max.z; z++) for (int x = replace_min.x; x <= replace_max.x; x++){
+        if (reference.get(x, y, z) == 2) reference.set(x, y, z, 5);
+    }
+    compare("replace", changes);
+    changes.clear();
+    glm::ivec3 fill_min(-20, 0, -10), fill_max(20, 31, 40);
+    bulk.fill(fill_min, fill_max, 3, &changes); // Over chunks that already contain some of the block
+    for (int y = fill_min.y; y <= fill_max.y; y++) for (int z = fill_min.z; z <= fill_max.z; z++) for (int x = fill_min.x; x <= fill_max.x; x++) reference.set(x, y, z, 3);
+    compare("fill", changes);
+    changes.clear();
+    bulk.replace(min, max, 7, 1, &changes); // No chunk contains block 7
+    check(changes.empty(), "replacing a block that isn't in the box records changes");
+
+    changes.clear();
+    glm::ivec3 clone_size(30, 20, 25), clone_from = min + 2, clone_to(min.x + 40, 10, min.z + 33);
+    bulk.paste(bulk.copy(clone_from, clone_from + clone_size - 1), clone_to, &changes);
+    std::vector<uint8_t> copied;
+    for (int y = 0; y < clone_size.y; y++) for (int z = 0; z < clone_size.z; z++) for (int x = 0; x < clone_size.x; x++) copied.push_back(reference.get(clone_from.x + x, clone_from.y + y, clone_from.z + z));
+    for (int y = 0, i = 0; y < clone_size.y; y++) for (int z = 0; z < clone_size.z; z++) for (int x = 0; x < clone_size.x; x++, i++) reference.set(clone_to.x + x, clone_to.y + y, clone_to.z + z, copied[i]);
+    compare("clone", changes);
+
+    for (glm::ivec3 center: {glm::ivec3(10, 20, 30), glm::ivec3(max.x, min.y, max.z)}){ // Inside the box, and on a corner with air around it
+        int radius = 17;
+        changes.clear();
+        bulk.remove_sphere(center, radius, &changes);
+        for (int y = center.y - radius; y <= center.y + radius; y++) for (int z = center.z - radius; z <= center.z + radius; z++) for (int x = center.x - radius; x <= center.x + radius; x++){
+            if ((x-center.x)*(x-center.x) + (y-center.y)*(y-center.y) + (z-center.z)*(z-center.z) <= radius*radius) reference.set(x, y, z, Chunk::air);
+        }
+        compare("explode", changes);
+    }
+}
+
+void test_frustum_culling(){ // Frustum::cull, with SSE where available, gives the same results as Frustum::intersects one cube at a time
+    std::mt19937 random(0);
+    std::uniform_real_distribution<float> coordinate(-200.0f, 200.0f);
+    const int num_cubes = 4099; // Not a multiple of 4, so that the last cubes are tested one at a time
+    std::vector<float> center_x(num_cubes), center_y(num_cubes), center_z(num_cubes);
+    for (int i = 0; i < num_cubes; i++){
+        center_x[i] = coordinate(random);
+        center_y[i] = coordinate(random)/4;
+        center_z[i] = coordinate(random);
+    }
+    for (glm::vec3 target: {glm::vec3(1.0f, 9.0f, 0.5f), glm::vec3(-3.0f, 12.0f, 2.0f), glm::vec3(0.2f, 10.0f, -1.0f)}){
+        Frustum frustum(glm::perspective(glm::radians(45.0f), 16.0f/9.0f, 0.1f, 100.0f) * glm::lookAt(glm::vec3(0.0f, 10.0f, 0.0f), target, glm::vec3(0.0f, 1.0f, 0.0f)));
+        std::vector<uint8_t> visible(num_cubes);
+        frustum.cull(&center_x[0], &center_y[0], &center_z[0], num_cubes, 8.0f, &visible[0]);
+        int num_different = 0, num_visible = 0;
+        for (int i = 0; i < num_cubes; i++){
+            num_different += visible[i] != frustum.intersects(glm::vec3(center_x[i], center_y[i], center_z[i]), 8.0f);
+            num_visible += visible[i];
+        }
+        check(num_different == 0, "frustum culling differs from testing the cubes one by one on " + std::to_string(num_different) + " cubes");
+        check(num_visible > 0 && num_visible < num_cubes, "frustum culling keeps all or none of the cubes");
+    }
+}
+
+void test_occlusion_culling(){ // Chunks behind a wall covering the view are hidden by the occlusion buffer, and the ones in front of it are not
+    glm::vec3 camera_pos(0.0f, 5.0f, 0.0f);
+    glm::mat4 view_projection = glm::perspective(glm::radians(45.0f), 16.0f/9.0f, 0.1f, 100.0f) * glm::lookAt(camera_pos, glm::vec3(0.0f, 5.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    Occlusion_buffer buffer;
+    buffer.clear(view_projection, camera_pos);
+    for (int i = -8; i < 8; i++) buffer.add_occluder({glm::vec3(4*i, -20, -12), glm::vec3(4*i + 4, 40, -10)}); // Wall of 16 boxes 10 blocks in front of the camera
+    int num_hidden = 0;
+    for (int x = -40; x < 40; x += 16){
+        for (int z = -80; z < 0; z += 16){
+            for (int y = 0; y < 32; y += 16){
+                glm::vec3 min(x, y, z), max(x + 16, y + 16, z + 16);
+                std::string name = "chunk at (" + std::to_string(x) + ", " + std::to_string(y) + ", " + std::to_string(z) + ")";
+                bool visible = buffer.visible(min, max);
+                num_hidden += !visible;
+                if (max.z <= -12) check(!visible, name + " behind the wall is not hidden");
+                if (max.z > -10 && Frustum(view_projection).intersects((min + max)*0.5f, 8.0f)) check(visible, name + " in front of the wall is hidden");
+            }
+        }
+    }
+    check(num_hidden > 0, "no chunk is hidden by the wall");
+    buffer.clear(view_projection, camera_pos);
+    check(buffer.visible(glm::vec3(-8, 0, -40), glm::vec3(8, 16, -24)), "a chunk is hidden by an empty occlusion buffer");
+}
+
+void test_render_queue_sort(){ // The radix sort of the render queue gives the same order as std::stable_sort, items with the same key included
+    std::mt19937 random(0);
+    std::uniform_real_distribution<float> distance(0.0f, 500.0f);
+    Render_queue queue;
+    for (int num_items: {0, 1, 7, 20000}){
+        queue.clear();
+        for (int i = 0; i < num_items; i++){
+            Render_queue::Pass pass = i % 8 == 0 ? Render_queue::transparent_pass : Render_queue::opaque_pass;
+            float depth = i % 3 == 0 ? 10.0f : distance(random); // Many equal keys, whose order must be kept
+            queue.submit({Render_queue::make_key(pass, 3 + i % 2, 1 + random() % 7, depth), nullptr, nullptr, {0, i, 6}});
+        }
+        std::vector<Render_item> expected = queue.items;
+        std::stable_sort(expected.begin(), expected.end(), [](const Render_item &a, const Render_item &b){ return a.key < b.key; });
+        queue.sort();
+        int num_different = 0;
+        for (int i = 0; i < num_items; i++) num_different += queue.items[i].range.first_index != expected[i].range.first_index;
+        check(queue.items.size() == num_items && num_different == 0, "the render queue of " + std::to_string(num_items) + " items is sorted differently from std::stable_sort");
+    }
+}
+
+bool covered(const Chunk_mesh_data &mesh, int axis, float plane, glm::vec3 normal, glm::vec3 point){ // Whether a quad of the mesh in the given plane, facing normal, covers point
+    int u = (axis + 1) % 3, v = (axis + 2) % 3;
+    for (int quad = 0; quad < mesh.vertices.size()/24; quad++){
+        const float* vertices = &mesh.vertices[24*quad]; // 4 vertices of 6 floats: position and normal
+        if (glm::vec3(vertices[3], vertices[4], vertices[5]) != normal || vertices[axis] != plane) continue;
+        float min_u = vertices[u], max_u = vertices[u], min_v = vertices[v], max_v = vertices[v];
+        for (int i = 1; i < 4; i++){
+            min_u = std::min(min_u, vertices[6*i + u]);
+            max_u = std::max(max_u, vertices[6*i + u]);
+            min_v = std::min(min_v, vertices[6*i + v]);
+            max_v = std::max(max_v, vertices[6*i + v]);
+        }
+        if (point[u] > min_u && point[u] < max_u && point[v] > min_v && point[v] < max_v) return true;
+    }
+    return false;
+}
+
+void test_lod_seams(){ // Where a full resolution chunk meets a downsampled one, every block of the seam that is solid on one side only has a face towards the other side
+    Terrain_generator generator(502);
+    World world;
+    for (int chunk_x = -1; chunk_x <= 2; chunk_x++) for (int chunk_z = -1; chunk_z <= 1; chunk_z++) for (Chunk &chunk: generator.generate_column(chunk_x, chunk_z)) world.insert_chunk(chunk);
+    std::array<bool, 256> opaque;
+    opaque.fill(true);
+    const int size = Chunk::size;
+    int num_squares = 0; // Squares of the seam that need a face, to make sure that the terrain crosses the seam
+    for (int scale: {2, 4, 8}){
+        for (auto &pair: world.chunks){
+            Chunk &full = pair.second;
+            Chunk* lod = world.get_chunk(1, full.chunk_y, 0);
+            if (full.chunk_x != 0 || full.chunk_z != 0 || lod == nullptr) continue;
+            Chunk_mesh_data full_mesh = Chunk_mesher::mesh_chunk(world, full, opaque, Chunk_mesher::positive_x_side), lod_mesh = Chunk_mesher::mesh_chunk_lod(world, *lod, opaque, scale);
+            float plane = size - 0.5f; // Blocks are centered on integer coordinates
+            for (int y = 0; y < size; y++){
+                for (int z = 0; z < size; z++){
+                    bool full_solid = full.get(size-1, y, z) != Chunk::air;
+                    int num_solid = 0; // Blocks of the cell of the downsampled chunk against block (size-1, y, z), solid if at least half of them are
+                    for (int k = 0; k < scale*scale*scale; k++) num_solid += lod->get(k % scale, (y/scale)*scale + k/(scale*scale), (z/scale)*scale + (k/scale) % scale) != Chunk::air;
+                    bool lod_solid = 2*num_solid >= scale*scale*scale;
+                    glm::vec3 point(plane, full.chunk_y*size + y, z);
+                    std::string name = "seam square (" + std::to_string(full.chunk_y*size + y) + ", " + std::to_string(z) + ") at scale " + std::to_string(scale);
+                    if (full_solid && !lod_solid) check(covered(full_mesh, 0, plane, glm::vec3(1, 0, 0), point), name + " has no face of the full resolution chunk");
+                    if (lod_solid && !full_solid) check(covered(lod_mesh, 0, plane, glm::vec3(-1, 0, 0), point), name + " has no face of the downsampled chunk");
+                    num_squares += full_solid != lod_solid;
+                }
+            }
+        }
+    }
+    check(num_squares > 0, "the terrain doesn't cross the seam between levels of detail");
+}
+
+int main(){
+    test_noise_backends();
+    test_region_round_trip();
+    test_tall_columns();
+    test_failed_save();
+    test_corrupted_chunks();
+    test_journal_replay();
+    test_edit_history();
+    test_bulk_edits();
+    test_frustum_culling();
+    test_occlusion_culling();
+    test_render_queue_sort();
+    test_lod_seams();
+    if (num_failures == 0) std::cout << "All checks passed" << std::endl;
+    return num_failures == 0 ? 0 : 1;
+}
@@ -9,12 +9,15 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtx/string_cast.hpp> // for to_string
 #include <fstream>
+#include <vector>
+#include <unordered_map>
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
 class Texture{
 public:
     static inline std::vector<Texture> textures;
+    static inline std::unordered_map<unsigned int, int> indices; // Index in textures of each texture, by texture_ID
     unsigned int texture_ID;
     float shininess; // Represents the amount of specular light reflected by this material texture
     bool opaque; // Whether this texture is completely opaque or not
@@ -56,6 +59,7 @@ public:
             this->direction = direction;
 
             // Each time we create a new texture we add it to the list of textures
+            Texture::indices[texture_ID] = Texture::textures.size();
             Texture::textures.push_back(*this);
             return;
         }
@@ -80,9 +84,23 @@ public:
         mirror = false;
 
         // Each time we create a new texture we add it to the list of textures
+        Texture::indices[texture_ID] = Texture::textures.size();
         Texture::textures.push_back(*this);
     }
 
+    static void remove(unsigned int texture_ID){ // Removes a mirror texture from textures in constant time, by moving the last texture in its place
+        // Blocks refer to their texture by texture ID (see Block_registry::textures), never by index in textures, so moving a texture breaks nothing
+        auto it = Texture::indices.find(texture_ID);
+        if (it == Texture::indices.end()) return;
+        int index = it->second;
+        Texture::indices.erase(it);
+        if (index != Texture::textures.size()-1){
+            Texture::textures[index] = Texture::textures.back();
+            Texture::indices[Texture::textures[index].texture_ID] = index;
+        }
+        Texture::textures.pop_back();
+    }
+
 
 };
 
@@ -0,0 +1,405 @@
+#ifndef WORLD_H
+#define WORLD_H
+
+#include <iostream>
+#include <glm/glm.hpp>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include "Chunk.h"
+#include "Edit_history.h"
+#include "Occupancy_tree.h"
+#include "Cube.h"
+
+struct Raycast_hit{
+    bool hit; // Whether a block was found before the maximum distance
+    glm::ivec3 block; // Coordinates of the hit block
+    glm::ivec3 normal; // Normal of the face of the block through which the ray entered it (zero if the ray started inside the block)
+    glm::ivec3 adjacent; // Empty cell in front of that face, where a block placed against the hit one goes
+    float distance; // Distance along the ray to the hit face
+};
+
+struct Schematic{ // Copy of the blocks of a box of the world, to paste it elsewhere
+    glm::ivec3 size;
+    std::vector<uint8_t> blocks; // x varying fastest then z then y, like in chunks
+
+    uint8_t get(int x, int y, int z) const { // Coordinates relative to the corner of the box
+        return blocks[x + size.x*(z + size.z*y)];
+    }
+};
+
+class World{
+public:
+    std::unordered_map<int64_t, Chunk> chunks; // Chunks of the world, keyed by their packed chunk coordinates (see chunk_key)
+    bool use_occupancy_tree = false; // Whether occupancy_tree is kept up to date and used to accelerate raycasts
+    Occupancy_tree occupancy_tree; // Optional index of the empty and full parts of the world
+
+    World() = default;
+    World(const World&) = delete; // The cache of get_chunk points inside chunks, so a copy would keep using the chunks of the original
+    World& operator=(const World&) = delete;
+
+    void enable_occupancy_tree(bool enable){ // Builds (or drops) the occupancy tree from the current blocks
+        use_occupancy_tree = enable;
+        occupancy_tree.clear();
+        if (enable) for_each_block([&](int x, int y, int z, uint8_t block){ occupancy_tree.set(x, y, z, true); });
+    }
+
+    uint8_t get(int x, int y, int z){ // Returns the block ID at world coordinates (x,y,z), air if the chunk doesn't exist
+        Chunk* chunk = get_chunk(chunk_coord(x), chunk_coord(y), chunk_coord(z));
+        if (chunk == nullptr) return Chunk::air;
+        return chunk->get(local_coord(x), local_coord(y), local_coord(z));
+    }
+
+    void set(int x, int y, int z, uint8_t block){ // Sets the block ID at world coordinates (x,y,z), creating the chunk if needed
+        int chunk_x = chunk_coord(x), chunk_y = chunk_coord(y), chunk_z = chunk_coord(z);
+        Chunk* chunk = get_chunk(chunk_x, chunk_y, chunk_z);
+        if (chunk == nullptr){
+            if (block == Chunk::air) return; // No need to create a chunk to put air in it
+            chunk = &chunks.emplace(chunk_key(chunk_x, chunk_y, chunk_z), Chunk(chunk_x, chunk_y, chunk_z)).first->second;
+        }
+        uint8_t old_block = chunk->get(local_coord(x), local_coord(y), local_coord(z));
+        chunk->set(local_coord(x), local_coord(y), local_coord(z), block);
+        if (use_occupancy_tree && (old_block == Chunk::air) != (block == Chunk::air)) occupancy_tree.set(x, y, z, block != Chunk::air);
+    }
+
+    void insert_chunk(Chunk chunk){ // Adds a whole chunk to the world, replacing the chunk at the same coordinates if there is one
+        remove_chunk(chunk.chunk_x, chunk.chunk_y, chunk.chunk_z);
+        if (use_occupancy_tree) chunk.for_each_block([&](int x, int y, int z, uint8_t block){ occupancy_tree.set(x, y, z, true); });
+        chunks.emplace(chunk_key(chunk.chunk_x, chunk.chunk_y, chunk.chunk_z), chunk);
+    }
+
+    void remove_chunk(int chunk_x, int chunk_y, int chunk_z){
+        if (chunks.erase(chunk_key(chunk_x, chunk_y, chunk_z)) == 0) return;
+        last_chunk = nullptr; // The cache might point to the removed chunk
+        if (use_occupancy_tree) occupancy_tree.clear_chunk(chunk_x, chunk_y, chunk_z);
+    }
+
+    bool solid(int x, int y, int z){
+        return get(x, y, z) != Chunk::air;
+    }
+
+    Raycast_hit raycast(glm::vec3 origin, glm::vec3 direction, float max_distance){
+        // Walks through the grid cells crossed by the ray, in order, until a solid one is found (Amanatides-Woo traversal)
+        // Block (x,y,z) fills [x-0.5, x+0.5] x [y-0.5, y+0.5] x [z-0.5, z+0.5] so we work in a grid shifted by 0.5
+        Raycast_hit result = {false, glm::ivec3(0), glm::ivec3(0), glm::ivec3(0), 0.0f};
+        if (use_occupancy_tree){ // Skip empty space hierarchically
+            result.hit = occupancy_tree.raycast(origin, direction, max_distance, result.block, result.normal, result.distance);
+            result.adjacent = result.block + result.normal;
+            return result;
+        }
+        direction = glm::normalize(direction);
+        glm::vec3 start = origin + 0.5f;
+        glm::ivec3 cell = glm::ivec3(glm::floor(start));
+        glm::ivec3 step; // Direction of the next cell on each axis
+        glm::vec3 t_max; // Distance along the ray to the next cell boundary on each axis
+        glm::vec3 t_delta; // Distance along the ray between two cell boundaries on each axis
+        for (int axis = 0; axis < 3; axis++){
+            if (direction[axis] > 0){
+                step[axis] = 1;
+                t_max[axis] = (cell[axis] + 1 - start[axis])/direction[axis];
+                t_delta[axis] = 1/direction[axis];
+            }
+            else if (direction[axis] < 0){
+                step[axis] = -1;
+                t_max[axis] = (cell[axis] - start[axis])/direction[axis];
+                t_delta[axis] = -1/direction[axis];
+            }
+            else{ // The ray never crosses a boundary on this axis
+                step[axis] = 0;
+                t_max[axis] = INFINITY;
+                t_delta[axis] = INFINITY;
+            }
+        }
+
+        glm::ivec3 normal(0);
+        float distance = 0.0f;
+        while (distance <= max_distance){
+            if (solid(cell.x, cell.y, cell.z)){
+                result.hit = true;
+                result.block = cell;
+                result.normal = normal;
+                result.adjacent = cell + normal;
+                result.distance = distance;
+                return result;
+            }
+            // Move to the next cell through the closest boundary
+            int axis = 0;
+            if (t_max[1] < t_max[axis]) axis = 1;
+            if (t_max[2] < t_max[axis]) axis = 2;
+            distance = t_max[axis];
+            cell[axis] += step[axis];
+            t_max[axis] += t_delta[axis];
+            normal = glm::ivec3(0);
+            normal[axis] = -step[axis];
+        }
+        return result;
+    }
+
+    Chunk* get_chunk(int chunk_x, int chunk_y, int chunk_z){ // Returns the chunk at these chunk coordinates, or nullptr if it doesn't exist
+        int64_t key = chunk_key(chunk_x, chunk_y, chunk_z);
+        if (last_chunk != nullptr && last_chunk_key == key) return last_chunk; // Consecutive queries are very often in the same chunk
+        auto it = chunks.find(key);
+        if (it == chunks.end()) return nullptr;
+        last_chunk = &it->second;
+        last_chunk_key = key;
+        return last_chunk;
+    }
+
+    template <typename Function> void for_each_chunk(Function function){ // Calls function(chunk) for all non-empty chunks
+        for (auto &pair: chunks) if (!pair.second.empty()) function(pair.second);
+    }
+
+    template <typename Function> void for_each_block(Function function){ // Calls function(x, y, z, block) for all non-air blocks of the world, chunk by chunk
+        for (auto &pair: chunks) pair.second.for_each_block(function);
+    }
+
+    // Bulk edits of the boxes [min, max] (bounds included), done chunk by chunk on the packed indices (see Chunk::fill). If changes isn't nullptr,
+    // the blocks that change are added to it with their old and new block, e.g. to update the instance buffers and the edit history
+    void fill(glm::ivec3 min, glm::ivec3 max, uint8_t block, std::vector<Block_delta>* changes = nullptr){ // Sets all the blocks of the box to block
+        if (changes != nullptr) changes->reserve(changes->size() + box_volume(min, max)); // Usually most blocks of the box change
+        edit_box(min, max, block != Chunk::air, changes, [&](const Chunk &chunk){ return chunk.uniform_block() == block; }, [&](int x, int y, int z, uint8_t old_block){ return block; },
+                 [&](Chunk &chunk, glm::ivec3 low, glm::ivec3 high){ chunk.fill(low.x, low.y, low.z, high.x, high.y, high.z, block); });
+    }
+
+    void replace(glm::ivec3 min, glm::ivec3 max, uint8_t from, uint8_t to, std::vector<Block_delta>* changes = nullptr){ // Replaces the blocks from of the box by to
+        edit_box(min, max, from == Chunk::air, changes, [&](const Chunk &chunk){ return from == to || !chunk.contains(from); }, [&](int x, int y, int z, uint8_t old_block){ return old_block == from ? to : old_block; },
+                 [&](Chunk &chunk, glm::ivec3 low, glm::ivec3 high){ chunk.replace(low.x, low.y, low.z, high.x, high.y, high.z, from, to); });
+    }
+
+    Schematic copy(glm::ivec3 min, glm::ivec3 max){ // Blocks of the box
+        Schematic schematic;
+        schematic.size = max - min + 1;
+        schematic.blocks.assign((size_t)schematic.size.x*schematic.size.y*schematic.size.z, Chunk::air);
+        for_each_chunk_in_box(min, max, false, [&](Chunk &chunk, glm::ivec3 low, glm::ivec3 high){
+            glm::ivec3 origin = glm::ivec3(chunk.chunk_x, chunk.chunk_y, chunk.chunk_z)*Chunk::size - min; // Chunk corner relative to the box
+            for (int y = low.y; y <= high.y; y++){
+                for (int z = low.z; z <= high.z; z++){
+                    uint8_t* row = &schematic.blocks[origin.x + schematic.size.x*(z + origin.z + schematic.size.z*(y + origin.y))]; // Block (0, y, z) of the chunk
+                    for (int x = low.x; x <= high.x; x++) row[x] = chunk.get(x, y, z);
+                }
+            }
+        });
+        return schematic;
+    }
+
+    void paste(const Schematic &schematic, glm::ivec3 min, std::vector<Block_delta>* changes = nullptr){ // Replaces the blocks of the box of schematic.size starting at min by the ones of schematic, air included
+        glm::ivec3 max = min + schematic.size - 1;
+        if (changes != nullptr) changes->reserve(changes->size() + box_volume(min, max));
+        edit_box(min, max, true, changes, [&](const Chunk &chunk){ return false; }, [&](int x, int y, int z, uint8_t old_block){ return schematic.get(x - min.x, y - min.y, z - min.z); },
+                 [&](Chunk &chunk, glm::ivec3 low, glm::ivec3 high){
+            glm::ivec3 origin = glm::ivec3(chunk.chunk_x, chunk.chunk_y, chunk.chunk_z)*Chunk::size - min;
+            chunk.paste(low.x, low.y, low.z, high.x, high.y, high.z, [&](int x, int y, int z){ return schematic.get(x + origin.x, y + origin.y, z + origin.z); });
+        });
+    }
+
+    void remove_sphere(glm::ivec3 center, int radius, std::vector<Block_delta>* changes = nullptr){ // Replaces by air the blocks whose center is at most radius from the center of block center
+        auto in_sphere = [&](int x, int y, int z){ return (x-center.x)*(x-center.x) + (y-center.y)*(y-center.y) + (z-center.z)*(z-center.z) <= radius*radius; };
+        edit_box(center - radius, center + radius, false, changes, [&](const Chunk &chunk){ return chunk.empty(); }, [&](int x, int y, int z, uint8_t old_block){ return in_sphere(x, y, z) ? Chunk::air : old_block; },
+                 [&](Chunk &chunk, glm::ivec3 low, glm::ivec3 high){
+            glm::ivec3 origin = glm::ivec3(chunk.chunk_x, chunk.chunk_y, chunk.chunk_z)*Chunk::size;
+            bool inside = true; // Whether the whole chunk is in the sphere (the sphere is convex so its corners are enough)
+            for (int corner = 0; corner < 8; corner++) inside = inside && in_sphere(origin.x + (corner & 1)*(Chunk::size-1), origin.y + ((corner >> 1) & 1)*(Chunk::size-1), origin.z + (corner >> 2)*(Chunk::size-1));
+            if (inside){
+                chunk.fill(0, 0, 0, Chunk::size-1, Chunk::size-1, Chunk::size-1, Chunk::air);
+                return;
+            }
+            chunk.fill_rows(Chunk::air, [&](int y, int z, int &row_x0, int &row_x1){ // Each row crosses the sphere on one run
+                int dy = origin.y + y - center.y, dz = origin.z + z - center.z;
+                int remaining = radius*radius - dy*dy - dz*dz;
+                if (remaining < 0) return false;
+                int half_width = (int)std::sqrt((double)remaining);
+                while ((half_width+1)*(half_width+1) <= remaining) half_width++; // Exact integer square root
+                while (half_width*half_width > remaining) half_width--;
+                row_x0 = std::max(low.x, center.x - half_width - origin.x);
+                row_x1 = std::min(high.x, center.x + half_width - origin.x);
+                return true;
+            });
+        });
+    }
+
+    static void benchmark_bulk(){ // Prints the number of blocks per second of each bulk edit, compared with setting the blocks one by one (checked to give the same world by the tests)
+        glm::ivec3 min(-100, 0, -100), max(155, 63, 155); // 256 x 64 x 256 blocks
+        long long volume = (long long)(max.x-min.x+1)*(max.y-min.y+1)*(max.z-min.z+1);
+        World bulk, reference;
+        auto seconds_since = [](std::chrono::steady_clock::time_point start){ return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(); };
+        auto print = [&](std::string name, long long num_blocks, double bulk_time, double reference_time){
+            std::cout << name << ": " << (long long)(num_blocks/bulk_time/1e6) << " M blocks/s (" << 1000*bulk_time << " ms), one by one: "
+                      << (long long)(num_blocks/reference_time/1e6) << " M blocks/s, " << reference_time/bulk_time << " times faster" << std::endl;
+        };
+
+        auto start = std::chrono::steady_clock::now();
+        bulk.fill(min, max, 2);
+        double bulk_time = seconds_since(start);
+        start = std::chrono::steady_clock::now();
+        for (int y = min.y; y <= max.y; y++) for (int z = min.z; z <= max.z; z++) for (int x = min.x; x <= max.x; x++) reference.set(x, y, z, 2);
+        print("Fill", volume, bulk_time, seconds_since(start));
+
+        std::mt19937 random(0); // Scatter other blocks so that replace has to look at the indices
+        for (int i = 0; i < volume/100; i++){
+            int x = min.x + random() % (max.x-min.x+1), y = min.y + random() % (max.y-min.y+1), z = min.z + random() % (max.z-min.z+1);
+            bulk.set(x, y, z, 1 + i % 3);
+            reference.set(x, y, z, 1 + i % 3);
+        }
+        glm::ivec3 replace_min(min.x + 3, min.y, min.z + 3), replace_max(max.x - 3, max.y - 3, max.z - 3); // Not aligned on chunks
+        long long replace_volume = (long long)(replace_max.x-replace_min.x+1)*(replace_max.y-replace_min.y+1)*(replace_max.z-replace_min.z+1);
+        start = std::chrono::steady_clock::now();
+        bulk.replace(replace_min, replace_max, 2, 5);
+        bulk_time = seconds_since(start);
+        start = std::chrono::steady_clock::now();
+        for (int y = replace_min.y; y <= replace_max.y; y++) for (int z = replace_min.z; z <= replace_max.z; z++) for (int x = replace_min.x; x <= replace_max.x; x++){
+            if (reference.get(x, y, z) == 2) reference.set(x, y, z, 5);
+        }
+        print("Replace", replace_volume, bulk_time, seconds_since(start));
+
+        glm::ivec3 clone_size(100, 40, 100), clone_from(min.x + 7, 5, min.z + 7), clone_to(min.x + 120, 20, min.z + 130);
+        long long clone_volume = (long long)clone_size.x*clone_size.y*clone_size.z;
+        start = std::chrono::steady_clock::now();
+        bulk.paste(bulk.copy(clone_from, clone_from + clone_size - 1), clone_to);
+        bulk_time = seconds_since(start);
+        start = std::chrono::steady_clock::now();
+        std::vector<uint8_t> copied;
+        for (int y = 0; y < clone_size.y; y++) for (int z = 0; z < clone_size.z; z++) for (int x = 0; x < clone_size.x; x++) copied.push_back(reference.get(clone_from.x + x, clone_from.y + y, clone_from.z + z));
+        for (int y = 0, i = 0; y < clone_size.y; y++) for (int z = 0; z < clone_size.z; z++) for (int x = 0; x < clone_size.x; x++, i++) reference.set(clone_to.x + x, clone_to.y + y, clone_to.z + z, copied[i]);
+        print("Clone", clone_volume, bulk_time, seconds_since(start));
+
+        glm::ivec3 center(20, 30, 30);
+        int radius = 30;
+        long long sphere_volume = 0;
+        start = std::chrono::steady_clock::now();
+        bulk.remove_sphere(center, radius);
+        bulk_time = seconds_since(start);
+        start = std::chrono::steady_clock::now();
+        for (int y = center.y - radius; y <= center.y + radius; y++) for (int z = center.z - radius; z <= center.z + radius; z++) for (int x = center.x - radius; x <= center.x + radius; x++){
+            if ((x-center.x)*(x-center.x) + (y-center.y)*(y-center.y) + (z-center.z)*(z-center.z) > radius*radius) continue;
+            reference.set(x, y, z, Chunk::air);
+            sphere_volume++;
+        }
+        print("Explode", sphere_volume, bulk_time, seconds_since(start));
+
+        std::vector<Block_delta> changes; // Cost of recording the changes, as done by Map
+        start = std::chrono::steady_clock::now();
+        bulk.fill(min, max, 3, &changes);
+        bulk_time = seconds_since(start);
+        std::cout << "Fill recording the changes: " << (long long)(volume/bulk_time/1e6) << " M blocks/s (" << changes.size() << " changes)" << std::endl;
+        changes.clear();
+        start = std::chrono::steady_clock::now();
+        bulk.replace(min, max, 2, 5, &changes); // The fill left no block 2, all the chunks are skipped from their palette
+        bulk_time = seconds_since(start);
+        std::cout << "Replace recording the changes: " << (long long)(volume/bulk_time/1e6) << " M blocks/s (" << changes.size() << " changes)" << std::endl;
+    }
+
+    long long memory_bytes() const { // Memory used by the chunks
+        long long total_bytes = 0;
+        for (auto &pair: chunks) total_bytes += pair.second.memory_bytes();
+        return total_bytes;
+    }
+
+    void print_memory_stats(){ // Prints the memory used per chunk, to compare with dense arrays (1 byte per block) and Cube objects
+        long long total_bytes = 0, num_blocks = 0;
+        int min_bytes = -1, max_bytes = 0;
+        int chunks_per_bits[9] = {}; // Number of chunks using 0, 1, 2, 4 and 8 bits per block
+        for (auto &pair: chunks){
+            int bytes = pair.second.memory_bytes();
+            total_bytes += bytes;
+            num_blocks += pair.second.num_blocks;
+            if (min_bytes == -1 || bytes < min_bytes) min_bytes = bytes;
+            max_bytes = std::max(max_bytes, bytes);
+            chunks_per_bits[pair.second.get_bits_per_block()]++;
+        }
+        if (chunks.empty()) return;
+        std::cout << "World: " << chunks.size() << " chunks, " << total_bytes/1024 << " KB (" << total_bytes/chunks.size() << " bytes per chunk on average, "
+                  << min_bytes << " at least, " << max_bytes << " at most), " << chunks.size()*Chunk::volume/1024 << " KB with dense arrays, "
+                  << num_blocks*sizeof(Cube)/1024 << " KB with Cube objects" << std::endl;
+        std::cout << "Bits per block: ";
+        for (int bits: {0, 1, 2, 4, 8}) std::cout << bits << " in " << chunks_per_bits[bits] << " chunks" << (bits == 8 ? "" : ", ");
+        std::cout << std::endl;
+    }
+
+    // Migration path from Cube objects: a cube becomes the block of type cube.block and conversely
+    void add_cube(Cube cube){
+        set(cube.x, cube.y, cube.z, cube.block);
+    }
+
+    Cube get_cube(int x, int y, int z){ // Only meaningful if solid(x, y, z)
+        return Cube(x, y, z, get(x, y, z));
+    }
+
+    static int chunk_coord(int x){ // Coordinate of the chunk containing world coordinate x (rounded towards minus infinity, also for negative x)
+        return x >= 0 ? x/Chunk::size : (x+1)/Chunk::size - 1;
+    }
+
+    static int local_coord(int x){ // Coordinate of world coordinate x inside its chunk, in [0, Chunk::size)
+        return x - chunk_coord(x)*Chunk::size;
+    }
+
+    static int64_t chunk_key(int chunk_x, int chunk_y, int chunk_z){
+        return pack_coordinates(chunk_x, chunk_y, chunk_z);
+    }
+
+    static int64_t block_key(int x, int y, int z){
+        return pack_coordinates(x, y, z);
+    }
+
+    static int64_t pack_coordinates(int x, int y, int z){ // Packs 3 integer coordinates on 21 bits each
+        const int64_t mask = (1 << 21) - 1;
+        return ((int64_t)(x & mask) << 42) | ((int64_t)(y & mask) << 21) | (int64_t)(z & mask);
+    }
+
+private:
+    template <typename Function> void for_each_chunk_in_box(glm::ivec3 min, glm::ivec3 max, bool create_chunks, Function function){ // Calls function(chunk, low, high) for the chunks overlapping the box,
+        // [low, high] being the part of the box inside the chunk in local coordinates. Missing chunks are created if create_chunks is true, and skipped otherwise
+        for (int chunk_y = chunk_coord(min.y); chunk_y <= chunk_coord(max.y); chunk_y++){
+            for (int chunk_z = chunk_coord(min.z); chunk_z <= chunk_coord(max.z); chunk_z++){
+                for (int chunk_x = chunk_coord(min.x); chunk_x <= chunk_coord(max.x); chunk_x++){
+                    Chunk* chunk = get_chunk(chunk_x, chunk_y, chunk_z);
+                    if (chunk == nullptr){
+                        if (!create_chunks) continue;
+                        chunk = &chunks.emplace(chunk_key(chunk_x, chunk_y, chunk_z), Chunk(chunk_x, chunk_y, chunk_z)).first->second;
+                    }
+                    glm::ivec3 origin = glm::ivec3(chunk_x, chunk_y, chunk_z)*Chunk::size;
+                    function(*chunk, glm::max(min - origin, glm::ivec3(0)), glm::min(max - origin, glm::ivec3(Chunk::size-1)));
+                }
+            }
+        }
+    }
+
+    static size_t box_volume(glm::ivec3 min, glm::ivec3 max){
+        return (size_t)(max.x-min.x+1)*(max.y-min.y+1)*(max.z-min.z+1);
+    }
+
+    template <typename Unchanged, typename New_block, typename Edit_chunk> void edit_box(glm::ivec3 min, glm::ivec3 max, bool create_chunks, std::vector<Block_delta>* changes, Unchanged unchanged, New_block new_block, Edit_chunk edit_chunk){
+        // Applies edit_chunk to the chunks of the box, new_block(x, y, z, old_block) telling what it does to each block for changes. The chunks for which unchanged(chunk) is true,
+        // known from their palette (e.g. without the block to replace), are skipped without reading their blocks
+        for_each_chunk_in_box(min, max, create_chunks, [&](Chunk &chunk, glm::ivec3 low, glm::ivec3 high){
+            if (unchanged(chunk)) return;
+            glm::ivec3 origin = glm::ivec3(chunk.chunk_x, chunk.chunk_y, chunk.chunk_z)*Chunk::size;
+            if (changes != nullptr){
+                int uniform_block = chunk.uniform_block(); // The rows of a chunk of a single block are only filled once
+                uint8_t row[Chunk::size];
+                if (uniform_block != -1) std::memset(row, uniform_block, Chunk::size);
+                for (int y = low.y; y <= high.y; y++){
+                    for (int z = low.z; z <= high.z; z++){
+                        if (uniform_block == -1) chunk.get_row(y, z, row);
+                        for (int x = low.x; x <= high.x; x++){
+                            uint8_t block = new_block(origin.x + x, origin.y + y, origin.z + z, row[x]);
+                            if (block != row[x]) changes->push_back({origin.x + x, origin.y + y, origin.z + z, row[x], block});
+                        }
+                    }
+                }
+            }
+            edit_chunk(chunk, low, high);
+            if (use_occupancy_tree){ // Rebuilt for the chunk, the blocks of the box being possibly all changed
+                occupancy_tree.clear_chunk(chunk.chunk_x, chunk.chunk_y, chunk.chunk_z);
+                chunk.for_each_block([&](int x, int y, int z, uint8_t block){ occupancy_tree.set(x, y, z, true); });
+            }
+        });
+    }
+
+    Chunk* last_chunk = nullptr; // Cache of the last chunk found by get_chunk (unordered_map never moves its elements, but the cache is reset when a chunk is removed)
+    int64_t last_chunk_key = 0;
+};
+#endif
@@ -0,0 +1,329 @@
+#ifndef WORLD_SAVE_H
+#define WORLD_SAVE_H
+
+#include <iostream>
+#include <vector>
+#include <map>
+#include <set>
+#include <tuple>
+#include <sstream>
+#include <memory>
+#include <string>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <functional>
+#include <random>
+#include <chrono>
+#include <filesystem>
+#include "Chunk.h"
+#include "Region_file.h"
+#include "Terrain_generator.h"
+
+class World_save{ // Directory of region files. Chunk columns are loaded from it by the streaming threads and saved to it by the main thread, directly or through a background thread
+public:
+    World_save(std::string directory){
+        this->directory = directory;
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+        if (error) std::cout << "Could not create save directory " << directory << ": " << error.message() << std::endl;
+        for (auto &entry: std::filesystem::directory_iterator(directory, error)){ // Region files stacked along y, found once so that loading a column doesn't look for them
+            int region_x, region_y, region_z;
+            if (parse_region_name(entry.path().filename().string(), region_x, region_y, region_z)) region_heights[std::make_pair(region_x, region_z)].insert(region_y);
+        }
+        writer = std::thread(&World_save::write_loop, this);
+    }
+
+    World_save(const World_save&) = delete; // Owns the thread
+    World_save& operator=(const World_save&) = delete;
+
+    ~World_save(){
+        {
+            std::lock_guard<std::mutex> lock(jobs_mutex);
+            stopping = true;
+        }
+        jobs_condition.notify_all();
+        writer.join(); // Writes the queued columns
+    }
+
+    bool load_column(int chunk_x, int chunk_z, Chunk_column &column){ // Reads the chunks of a column, returns false if the column was never saved
+        {
+            std::lock_guard<std::mutex> lock(jobs_mutex);
+            auto it = unsaved.find(std::make_pair(chunk_x, chunk_z));
+            if (it != unsaved.end()){ // Queued for saving: newer than the region file
+                column = it->second.second; // Shares the blocks of the snapshot, see Chunk
+                return true;
+            }
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        int region_x = region_coord(chunk_x), region_z = region_coord(chunk_z);
+        int local_x = chunk_x - region_x*Region_file::size, local_z = chunk_z - region_z*Region_file::size;
+        column.chunk_x = chunk_x;
+        column.chunk_z = chunk_z;
+        column.chunks.clear();
+        bool saved = false;
+        for (int region_y: region_heights[std::make_pair(region_x, region_z)]){
+            Region_file* region = get_region(region_x, region_y, region_z);
+            if (!region->is_open()) continue;
+            for (int local_y = 0; local_y < Region_file::height; local_y++){
+                int index = Region_file::entry_index(local_x, local_y, local_z), chunk_y = region_y*Region_file::height + local_y;
+                if (!region->has_chunk(index)) continue;
+                saved = true;
+                Chunk chunk(chunk_x, chunk_y, chunk_z);
+                if (region->read_chunk(index, chunk)) column.chunks.push_back(chunk);
+                else std::cout << "Chunk (" << chunk_x << ", " << chunk_y << ", " << chunk_z << ") is corrupted in the save" << std::endl;
+            }
+        }
+        return saved;
+    }
+
+    int save_columns(const std::vector<Chunk_column> &columns){ // Replaces the saved columns by these ones, each region file being rewritten once and synced to disk. Returns the number of chunks that couldn't be saved
+        // Columns are saved whole (even their empty chunks) so that a saved column is never mixed with a generated one
+        std::lock_guard<std::mutex> lock(mutex);
+        std::map<std::pair<int, int>, std::vector<const Chunk_column*>> columns_per_region;
+        for (const Chunk_column &column: columns) columns_per_region[std::make_pair(region_coord(column.chunk_x), region_coord(column.chunk_z))].push_back(&column);
+
+        int num_skipped = 0;
+        for (auto &pair: columns_per_region){
+            int region_x = pair.first.first, region_z = pair.first.second;
+            std::set<int> &heights = region_heights[pair.first];
+            std::set<int> written_heights = heights; // Region files of the old chunks of these columns, and of the new ones
+            written_heights.insert(0); // Where the columns without chunks are marked
+            for (const Chunk_column* column: pair.second) for (const Chunk &chunk: column->chunks) written_heights.insert(region_coord(chunk.chunk_y, Region_file::height));
+            for (int region_y: written_heights){
+                std::vector<std::vector<uint8_t>> entries(Region_file::num_entries);
+                Region_file* region = get_region(region_x, region_y, region_z);
+                for (int index = 0; index < Region_file::num_entries; index++){ // Keep the other columns of the region as they are
+                    int chunk_bytes;
+                    const uint8_t* bytes = region->chunk_data(index, chunk_bytes);
+                    if (bytes != nullptr) entries[index].assign(bytes, bytes + chunk_bytes);
+                }
+                bool changed = false;
+                for (const Chunk_column* column: pair.second){
+                    int local_x = column->chunk_x - region_x*Region_file::size, local_z = column->chunk_z - region_z*Region_file::size;
+                    for (int local_y = 0; local_y < Region_file::height; local_y++){
+                        std::vector<uint8_t> &entry = entries[Region_file::entry_index(local_x, local_y, local_z)];
+                        changed = changed || !entry.empty();
+                        entry.clear();
+                    }
+                    if (column->chunks.empty() && region_y == 0){ // Marks the column as saved
+                        Chunk(column->chunk_x, 0, column->chunk_z).write(entries[Region_file::entry_index(local_x, 0, local_z)]);
+                        changed = true;
+                    }
+                    for (const Chunk &chunk: column->chunks){
+                        if (region_coord(chunk.chunk_y, Region_file::height) != region_y) continue;
+                        chunk.write(entries[Region_file::entry_index(local_x, chunk.chunk_y - region_y*Region_file::height, local_z)]);
+                        changed = true;
+                    }
+                }
+                if (!changed) continue; // No chunk of these columns in this region file, before or now
+                regions.erase(std::make_tuple(region_x, region_y, region_z)); // Close the old file before replacing it
+                if (!Region_file::write(region_path(region_x, region_y, region_z), entries)){ // Not on disk, or not durably
+                    for (const Chunk_column* column: pair.second) num_skipped += std::max((int)column->chunks.size(), 1);
+                    continue;
+                }
+                heights.insert(region_y);
+            }
+        }
+        return num_skipped;
+    }
+
+    void save_columns_async(std::vector<Chunk_column> columns, std::function<void()> on_saved = nullptr){ // Saves the columns from the background thread, then calls on_saved from it if they are all on disk
+        // The columns should be snapshots (copies of the chunks of the world, see Chunk) so that the world can keep being edited meanwhile
+        // Saves are done in the order they are queued, and load_column returns the queued columns until they are written
+        std::lock_guard<std::mutex> lock(jobs_mutex);
+        for (const Chunk_column &column: columns){
+            std::pair<int, Chunk_column> &entry = unsaved[std::make_pair(column.chunk_x, column.chunk_z)];
+            entry.first++;
+            entry.second = column;
+        }
+        jobs.push_back({std::move(columns), on_saved});
+        jobs_condition.notify_all();
+    }
+
+    bool saving(){ // Whether columns queued by save_columns_async are not written yet
+        std::lock_guard<std::mutex> lock(jobs_mutex);
+        return !jobs.empty() || writing;
+    }
+
+    void wait_for_saves(){ // Waits until all the columns queued by save_columns_async are written
+        std::unique_lock<std::mutex> lock(jobs_mutex);
+        jobs_condition.wait(lock, [&]{ return jobs.empty() && !writing; });
+    }
+
+    static void benchmark(std::string directory, int seed){ // Saves a 1024 x 1024 blocks world, loads it back and compares the load time with the generation time (Tests.cpp checks the round trip)
+        const int num_chunks_side = 1024/Chunk::size;
+        std::filesystem::remove_all(directory);
+        Terrain_generator generator(seed);
+        std::vector<Chunk_column> generated;
+        auto start = std::chrono::steady_clock::now();
+        for (int chunk_x = 0; chunk_x < num_chunks_side; chunk_x++){
+            for (int chunk_z = 0; chunk_z < num_chunks_side; chunk_z++) generated.push_back({chunk_x, chunk_z, generator.generate_column(chunk_x, chunk_z)});
+        }
+        double generation_time = seconds_since(start);
+
+        start = std::chrono::steady_clock::now();
+        World_save(directory).save_columns(generated);
+        double save_time = seconds_since(start);
+        uintmax_t save_bytes = 0;
+        for (auto &entry: std::filesystem::directory_iterator(directory)) save_bytes += entry.file_size();
+
+        World_save save(directory); // Nothing opened yet
+        std::vector<Chunk_column> loaded(generated.size());
+        start = std::chrono::steady_clock::now();
+        for (int i = 0; i < generated.size(); i++) save.load_column(generated[i].chunk_x, generated[i].chunk_z, loaded[i]);
+        double load_time = seconds_since(start);
+
+        int num_chunks = 0;
+        for (Chunk_column &column: loaded) num_chunks += column.chunks.size();
+        std::cout << "Region files: " << num_chunks << " chunks (" << generated.size() << " columns) generated in " << 1000*generation_time << " ms, saved in "
+                  << 1000*save_time << " ms (" << save_bytes/1024 << " KB), loaded in " << 1000*load_time << " ms ("
+                  << generation_time/load_time << " times faster than generating)" << std::endl;
+        std::filesystem::remove_all(directory);
+    }
+
+    static void benchmark_autosave(std::string directory, int seed){ // Prints the frame times of a simulated game loop editing the world while 10k modified chunks are saved in the background
+        // Each frame edits random blocks, then sleeps until 16.7 ms. The autosave only takes a snapshot on the main thread, edits then copy the chunks they modify
+        const int num_columns_side = 100, num_chunks_y = 1;
+        const int edits_per_frame = 1000, num_frames_before = 60;
+        const double frame_time = 1.0/60;
+        std::filesystem::remove_all(directory);
+        Terrain_generator generator(seed);
+        std::map<std::pair<int, int>, std::vector<Chunk>> world;
+        int num_chunks = 0;
+        for (int chunk_x = 0; chunk_x < num_columns_side; chunk_x++){
+            for (int chunk_z = 0; chunk_z < num_columns_side; chunk_z++){
+                std::vector<Chunk> &column = world[std::make_pair(chunk_x, chunk_z)];
+                column = generator.generate_column(chunk_x, chunk_z);
+                column.resize(std::min((int)column.size(), num_chunks_y), Chunk(0, 0, 0));
+                num_chunks += column.size();
+            }
+        }
+
+        World_save save(directory);
+        std::mt19937 random(seed);
+        auto edit = [&](){ // One frame of edits
+            for (int i = 0; i < edits_per_frame; i++){
+                std::vector<Chunk> &column = world[std::make_pair(random() % num_columns_side, random() % num_columns_side)];
+                if (!column.empty()) column[0].set(random() % Chunk::size, random() % Chunk::size, random() % Chunk::size, random() % 8);
+            }
+        };
+        auto run_frame = [&](double &max_time, double &sum_time){
+            auto start = std::chrono::steady_clock::now();
+            edit();
+            double time = seconds_since(start);
+            max_time = std::max(max_time, time);
+            sum_time += time;
+            std::this_thread::sleep_for(std::chrono::duration<double>(std::max(0.0, frame_time - time)));
+        };
+
+        double max_before = 0.0, sum_before = 0.0;
+        for (int frame = 0; frame < num_frames_before; frame++) run_frame(max_before, sum_before);
+
+        Chunk::num_copies_on_write = 0;
+        auto start = std::chrono::steady_clock::now();
+        std::vector<Chunk_column> snapshot;
+        for (auto &pair: world) snapshot.push_back({pair.first.first, pair.first.second, pair.second}); // Copies that share the blocks of the world
+        save.save_columns_async(std::move(snapshot));
+        double snapshot_time = seconds_since(start);
+        double max_during = 0.0, sum_during = 0.0;
+        int num_frames_during = 0;
+        while (save.saving()){
+            run_frame(max_during, sum_during);
+            num_frames_during++;
+        }
+        double save_time = seconds_since(start);
+
+        std::cout << "Autosave of " << num_chunks << " chunks: snapshot taken in " << 1000*snapshot_time << " ms on the main thread, written in " << 1000*save_time
+                  << " ms in the background (" << num_frames_during << " frames)" << std::endl;
+        std::cout << "Work per frame (" << edits_per_frame << " edits): " << 1000*sum_before/num_frames_before << " ms on average and " << 1000*max_before << " ms at most before the autosave, "
+                  << 1000*sum_during/std::max(1, num_frames_during) << " ms on average and " << 1000*max_during << " ms at most during it (" << Chunk::num_copies_on_write << " chunks copied on write)" << std::endl;
+        std::filesystem::remove_all(directory);
+    }
+
+private:
+    struct Save_job{
+        std::vector<Chunk_column> columns;
+        std::function<void()> on_saved;
+    };
+
+    std::string directory;
+    std::mutex mutex; // Protects regions, load_column being called from several threads
+    std::thread writer; // Background thread saving the columns of save_columns_async
+    std::mutex jobs_mutex; // Protects jobs, unsaved, writing and stopping
+    std::condition_variable jobs_condition;
+    std::deque<Save_job> jobs;
+    std::map<std::pair<int, int>, std::pair<int, Chunk_column>> unsaved; // Last queued version of each column not written yet, with the number of queued jobs containing it
+    bool writing = false; // Whether the writer is writing a job it removed from jobs
+    bool stopping = false;
+    bool failed_save = false; // Whether some columns of save_columns_async could not be written, only used by the writer
+    std::map<std::tuple<int, int, int>, std::unique_ptr<Region_file>> regions; // Region files opened so far, keyed by region coordinates
+    std::map<std::pair<int, int>, std::set<int>> region_heights; // Region coordinates along y of the region files of each (region_x, region_z). Protected by mutex
+
+    Region_file* get_region(int region_x, int region_y, int region_z){ // Opens the region file if needed. It might not exist, in which case is_open is false
+        std::unique_ptr<Region_file> &region = regions[std::make_tuple(region_x, region_y, region_z)];
+        if (region == nullptr) region = std::make_unique<Region_file>(region_path(region_x, region_y, region_z));
+        return region.get();
+    }
+
+    void write_loop(){
+        while (true){
+            Save_job job;
+            {
+                std::unique_lock<std::mutex> lock(jobs_mutex);
+                jobs_condition.wait(lock, [&]{ return stopping || !jobs.empty(); });
+                if (jobs.empty()) return; // Stopping once everything is written
+                job = std::move(jobs.front());
+                jobs.pop_front();
+                writing = true;
+            }
+            int num_skipped = save_columns(job.columns);
+            if (num_skipped > 0){
+                std::cout << num_skipped << " chunks could not be saved" << std::endl;
+                failed_save = true;
+            }
+            if (!failed_save && job.on_saved) job.on_saved(); // After a failed save, on_saved is never called so that the journal keeps the edits that were not saved
+            {
+                std::lock_guard<std::mutex> lock(jobs_mutex);
+                for (const Chunk_column &column: job.columns){ // Loading a column now reads the region file, unless a newer version is still queued
+                    auto it = unsaved.find(std::make_pair(column.chunk_x, column.chunk_z));
+                    if (--it->second.first == 0) unsaved.erase(it);
+                }
+                job.columns.clear(); // Releases the snapshot, so that the world doesn't copy the chunks it edits anymore
+                writing = false;
+            }
+            jobs_condition.notify_all();
+        }
+    }
+
+    std::string region_path(int region_x, int region_y, int region_z){ // r.x.z.region for the regions at y 0, which were the only ones in older saves, and r.x.z.y.region above and below
+        return directory + "r." + std::to_string(region_x) + "." + std::to_string(region_z) + (region_y == 0 ? "" : "." + std::to_string(region_y)) + ".region";
+    }
+
+    static bool parse_region_name(std::string name, int &region_x, int &region_y, int &region_z){ // Reverse of region_path, false if name isn't the name of a region file
+        const std::string prefix = "r.", suffix = ".region";
+        if (name.size() <= prefix.size() + suffix.size() || name.compare(0, prefix.size(), prefix) != 0 || name.compare(name.size() - suffix.size(), suffix.size(), suffix) != 0) return false;
+        std::vector<int> coordinates;
+        std::stringstream middle(name.substr(prefix.size(), name.size() - prefix.size() - suffix.size()));
+        std::string part;
+        while (std::getline(middle, part, '.')){
+            if (part.empty() || part.find_first_not_of("-0123456789") != std::string::npos) return false;
+            coordinates.push_back(std::stoi(part));
+        }
+        if (coordinates.size() != 2 && coordinates.size() != 3) return false;
+        region_x = coordinates[0];
+        region_z = coordinates[1];
+        region_y = coordinates.size() == 3 ? coordinates[2] : 0;
+        return true;
+    }
+
+    static int region_coord(int chunk_x, int region_size = Region_file::size){ // Coordinate of the region containing chunk coordinate chunk_x (rounded towards minus infinity)
+        return chunk_x >= 0 ? chunk_x/region_size : (chunk_x+1)/region_size - 1;
+    }
+
+    static double seconds_since(std::chrono::steady_clock::time_point start){
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+};
+#endif